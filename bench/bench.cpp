@@ -0,0 +1,349 @@
+// Бенчмарки обхода, подсчёта и удаления на синтетических деревьях.
+// Вывод в духе Google Benchmark: время на итерацию, элементов в секунду,
+// файловых системных вызовов на элемент (по счётчикам profile.h) и выделений
+// памяти на итерацию (замещённый operator new).
+
+#include "treegen.h"
+
+#include "../src/cleaner.h"
+#include "../src/deleter.h"
+#include "../src/fsops.h"
+#include "../src/logger.h"
+#include "../src/profile.h"
+#include "../src/report.h"
+#include "../src/scanner.h"
+#include "../src/utils.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <new>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+/// Выделения памяти через operator new во всех потоках
+std::atomic<std::uint64_t> allocations{0};
+
+} // namespace
+
+void *operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *memory = std::malloc(size ? size : 1)) return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+namespace {
+
+struct BenchOptions {
+    std::string dir;                // Где строить деревья
+    double scale = 1.0;             // Множитель размеров деревьев
+    double minTime = 0.5;           // Минимум секунд замеров на бенчмарк
+    std::string filter = ".*";      // Регулярное выражение по имени
+    std::string jsonFile;           // Итоги в JSON (пусто — не писать)
+    unsigned jobs = 0;
+    IO_BACKEND ioBackend = IO_BACKEND::THREADS;
+    bool keepTrees = false;         // Не удалять деревья после прогона
+};
+
+/// Один бенчмарк: run возвращает число обработанных элементов за итерацию
+struct Benchmark {
+    std::string name;
+    TREE_LAYOUT layout;
+    bool consumesTree;              // Итерация удаляет дерево: перед следующей оно строится заново
+    bool needsTree;
+    std::function<std::uint64_t(const TreeInfo &)> run;
+};
+
+struct Result {
+    std::string name;
+    std::uint64_t iterations = 0;
+    double wallMs = 0;
+    double cpuMs = 0;
+    std::uint64_t entries = 0;
+    std::uint64_t syscalls = 0;
+    std::uint64_t allocations = 0;
+};
+
+std::uint64_t fsSyscalls() {
+    return profile::total(profile::Open) + profile::total(profile::Readdir) + profile::total(profile::Stat) +
+           profile::total(profile::Unlink) + profile::total(profile::Rmdir);
+}
+
+std::uint64_t scanEntries(const std::vector<PathScan> &scans) {
+    std::uint64_t entries = 0;
+    for (const auto &scan : scans) entries += scan.files + scan.dirs;
+    return entries;
+}
+
+std::vector<Benchmark> makeBenchmarks(const BenchOptions &options) {
+    const TREE_LAYOUT layouts[] = {
+        TREE_LAYOUT::WIDE_FLAT, TREE_LAYOUT::DEEP_NARROW, TREE_LAYOUT::TINY_FILES,
+        TREE_LAYOUT::HARDLINKED, TREE_LAYOUT::FIREFOX
+    };
+    std::vector<Benchmark> benchmarks;
+    for (TREE_LAYOUT layout : layouts) {
+        std::string suffix = std::string("/") + layoutName(layout);
+        bool inodes = layout == TREE_LAYOUT::HARDLINKED;
+
+        benchmarks.push_back({"scan" + suffix, layout, false, true, [&options, inodes](const TreeInfo &tree) {
+            ScanOptions scanOptions;
+            scanOptions.jobs = options.jobs;
+            scanOptions.inodeAccounting = inodes;
+            return scanEntries(scanPaths(tree.paths, scanOptions));
+        }});
+
+        benchmarks.push_back({"count" + suffix, layout, false, true, [&options](const TreeInfo &tree) {
+            ScanOptions scanOptions;
+            scanOptions.jobs = options.jobs;
+            scanOptions.keepEntries = false;
+            return scanEntries(scanPaths(tree.paths, scanOptions));
+        }});
+
+        // Как Cleaner::run в режиме snapshot: снимок, затем удаление снизу вверх
+        benchmarks.push_back({"delete" + suffix, layout, true, true, [&options](const TreeInfo &tree) {
+            ScanOptions scanOptions;
+            scanOptions.jobs = options.jobs;
+            std::vector<PathScan> scans = scanPaths(tree.paths, scanOptions);
+            DeleteOptions deleteOptions;
+            deleteOptions.jobs = options.jobs;
+            Deleter deleter(deleteOptions, [](const ScanEntry &, const std::string &, size_t, bool,
+                                                      const std::error_code &) {});
+            for (const auto &scan : scans) deleter.add(scan);
+            deleter.wait();
+            return scanEntries(scans);
+        }});
+
+        benchmarks.push_back({"stream" + suffix, layout, true, true, [&options](const TreeInfo &tree) {
+            std::uint64_t before = profile::total(profile::Entries);
+            DeleteOptions deleteOptions;
+            deleteOptions.jobs = options.jobs;
+            Deleter deleter(deleteOptions, [](const ScanEntry &, const std::string &, size_t, bool,
+                                                      const std::error_code &) {});
+            for (const auto &path : tree.paths) deleter.addStream(path);
+            deleter.wait();
+            return profile::total(profile::Entries) - before;
+        }});
+    }
+
+    // Полный план через Cleaner: разворачивание Profiles/*/cache2 и подсчёт
+    benchmarks.push_back({"plan/firefox", TREE_LAYOUT::FIREFOX, false, true, [&options](const TreeInfo &tree) {
+        Config config;
+        config.targetOS = OS_TYPE::LINUX;
+        config.useCache = false;
+        config.jobs = options.jobs;
+        for (size_t i = 0; i < tree.targets.size(); ++i) {
+            config.linuxPaths.push_back({"target" + std::to_string(i), tree.targets[i]});
+        }
+        Cleaner cleaner(config);
+        auto counts = cleaner.countItemsToDelete();
+        return static_cast<std::uint64_t>(std::get<0>(counts) + std::get<1>(counts));
+    }});
+
+    // Разворачивание шаблона в сотни тысяч путей и разбор пересечений целей
+    benchmarks.push_back({"targets/wide_flat", TREE_LAYOUT::WIDE_FLAT, false, true, [](const TreeInfo &tree) {
+        Config config;
+        config.targetOS = OS_TYPE::LINUX;
+        config.linuxPaths.push_back({"target", (fs::path(tree.root) / "*").string()});
+        Cleaner cleaner(config);
+        std::uint64_t paths = 0;
+        for (const auto &group : cleaner.groups()) paths += group.paths.size();
+        return paths;
+    }});
+
+    // Разворачивание переменных окружения и тильды в путях конфига
+    benchmarks.push_back({"expand_path", TREE_LAYOUT::WIDE_FLAT, false, false, [](const TreeInfo &) {
+        static const char *const kPaths[] = {
+            "~/.cache/pip", "$HOME/.npm/_cacache", "${XDG_CACHE_HOME}/thumbnails",
+            "%TEMP%", "%LocalAppData%\\Google\\Chrome\\User Data\\Default\\Cache", "/var/tmp"
+        };
+        const std::uint64_t rounds = 1000;
+        static volatile std::size_t sink = 0;   // Чтобы результат не выбросил оптимизатор
+        for (std::uint64_t i = 0; i < rounds; ++i) {
+            for (const char *path : kPaths) sink = sink + expandPath(path).size();
+        }
+        return rounds * (sizeof(kPaths) / sizeof(kPaths[0]));
+    }});
+    return benchmarks;
+}
+
+std::string formatRate(double perSecond) {
+    char buffer[32];
+    if (perSecond >= 1e6) {
+        std::snprintf(buffer, sizeof(buffer), "%.2fM/s", perSecond / 1e6);
+    } else if (perSecond >= 1e3) {
+        std::snprintf(buffer, sizeof(buffer), "%.2fk/s", perSecond / 1e3);
+    } else {
+        std::snprintf(buffer, sizeof(buffer), "%.0f/s", perSecond);
+    }
+    return buffer;
+}
+
+void printHeader() {
+    std::string line(106, '-');
+    std::printf("%s\n%-28s %13s %13s %11s %12s %13s %13s\n%s\n", line.c_str(), "Benchmark", "Time", "CPU",
+                "Iterations", "entries/s", "syscalls/e", "allocs/it", line.c_str());
+}
+
+void printResult(const Result &result) {
+    double wall = result.wallMs / result.iterations;
+    double cpu = result.cpuMs / result.iterations;
+    double rate = result.wallMs > 0 ? result.entries / (result.wallMs / 1000) : 0;
+    char perEntry[32] = "-";
+    if (result.entries > 0 && result.syscalls > 0) {
+        std::snprintf(perEntry, sizeof(perEntry), "%.2f", static_cast<double>(result.syscalls) / result.entries);
+    }
+    std::printf("%-28s %10.2f ms %10.2f ms %11llu %12s %13s %13llu\n", result.name.c_str(), wall, cpu,
+                static_cast<unsigned long long>(result.iterations), formatRate(rate).c_str(), perEntry,
+                static_cast<unsigned long long>(result.allocations / result.iterations));
+    std::fflush(stdout);
+}
+
+void writeJson(const std::string &path, const BenchOptions &options, const std::vector<Result> &results) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        LOG_ERROR("Не удалось открыть файл результатов: " + path);
+        return;
+    }
+    JsonWriter json(out);
+    json.beginObject();
+    json.key("context");
+    json.beginObject();
+    json.field("scale", options.scale);
+    json.field("dir", options.dir);
+    json.field("io_backend", ioBackendName(currentIoBackend()));
+    json.field("jobs", static_cast<std::uint64_t>(options.jobs));
+    json.endObject();
+    json.key("benchmarks");
+    json.beginArray();
+    for (const auto &result : results) {
+        json.beginObject();
+        json.field("name", result.name);
+        json.field("iterations", result.iterations);
+        json.field("real_time", result.wallMs / result.iterations);
+        json.field("cpu_time", result.cpuMs / result.iterations);
+        json.field("time_unit", "ms");
+        json.field("entries", result.entries);
+        json.field("syscalls", result.syscalls);
+        json.field("allocations_per_iteration", result.allocations / result.iterations);
+        json.field("entries_per_second", result.wallMs > 0 ? result.entries / (result.wallMs / 1000) : 0.0);
+        json.field("syscalls_per_entry",
+                   result.entries > 0 ? static_cast<double>(result.syscalls) / result.entries : 0.0);
+        json.endObject();
+    }
+    json.endArray();
+    json.endObject();
+    out << '\n';
+}
+
+void printUsage() {
+    std::cout << "Использование: cleaner_bench [--dir=<путь>] [--scale=<k>] [--filter=<regex>]\n"
+                 "                     [--min-time=<сек>] [--json=<файл>] [--jobs=<n>]\n"
+                 "                     [--io-backend=<threads|uring|std>] [--keep-trees]\n";
+}
+
+bool parseOptions(int argc, char *argv[], BenchOptions &options) {
+    options.dir = defaultBenchDir();
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&](const std::string &name) { return arg.substr(name.size() + 1); };
+        if (arg.rfind("--dir=", 0) == 0) {
+            options.dir = value("--dir");
+        } else if (arg.rfind("--scale=", 0) == 0) {
+            options.scale = std::atof(value("--scale").c_str());
+        } else if (arg.rfind("--min-time=", 0) == 0) {
+            options.minTime = std::atof(value("--min-time").c_str());
+        } else if (arg.rfind("--filter=", 0) == 0) {
+            options.filter = value("--filter");
+        } else if (arg.rfind("--json=", 0) == 0) {
+            options.jsonFile = value("--json");
+        } else if (arg.rfind("--jobs=", 0) == 0) {
+            options.jobs = static_cast<unsigned>(std::strtoul(value("--jobs").c_str(), nullptr, 10));
+        } else if (arg.rfind("--io-backend=", 0) == 0) {
+            std::string name = value("--io-backend");
+            if (name == "uring") options.ioBackend = IO_BACKEND::URING;
+            else if (name == "std") options.ioBackend = IO_BACKEND::STD;
+            else options.ioBackend = IO_BACKEND::THREADS;
+        } else if (arg == "--keep-trees") {
+            options.keepTrees = true;
+        } else {
+            if (arg != "--help" && arg != "-h") std::cerr << "Неизвестный аргумент: " << arg << "\n";
+            printUsage();
+            return false;
+        }
+    }
+    return options.scale > 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options)) return 1;
+    initLogger(false);
+    setIoBackend(options.ioBackend);
+
+    std::regex filter(options.filter);
+    std::string base = (fs::path(options.dir) / "kleyner-bench").string();
+    std::map<TREE_LAYOUT, TreeInfo> trees;
+    std::map<TREE_LAYOUT, bool> consumed;
+    auto tree = [&](TREE_LAYOUT layout) -> const TreeInfo & {
+        auto it = trees.find(layout);
+        if (it == trees.end() || consumed[layout]) {
+            std::string root = (fs::path(base) / layoutName(layout)).string();
+            trees[layout] = generateTree(layout, root, options.scale);
+            consumed[layout] = false;
+        }
+        return trees[layout];
+    };
+
+    std::printf("Деревья: %s, масштаб %.2f, бэкенд %s\n", base.c_str(), options.scale,
+                ioBackendName(currentIoBackend()));
+    printHeader();
+    std::vector<Result> results;
+    for (const auto &benchmark : makeBenchmarks(options)) {
+        if (!std::regex_search(benchmark.name, filter)) continue;
+        Result result;
+        result.name = benchmark.name;
+        while (result.iterations == 0 || (result.wallMs < options.minTime * 1000 && result.iterations < 1000)) {
+            static const TreeInfo none;
+            const TreeInfo &info = benchmark.needsTree ? tree(benchmark.layout) : none;
+            std::uint64_t syscalls = fsSyscalls();
+            std::uint64_t allocated = allocations.load();
+            PhaseTimer timer;
+            result.entries += benchmark.run(info);
+            result.wallMs += timer.wallMs();
+            result.cpuMs += timer.cpuMs();
+            result.syscalls += fsSyscalls() - syscalls;
+            result.allocations += allocations.load() - allocated;
+            result.iterations++;
+            if (benchmark.consumesTree) consumed[benchmark.layout] = true;
+        }
+        printResult(result);
+        results.push_back(result);
+    }
+
+    if (!options.jsonFile.empty()) writeJson(options.jsonFile, options, results);
+    if (!options.keepTrees) {
+        std::error_code ec;
+        fs::remove_all(base, ec);
+    }
+    return 0;
+}
@@ -0,0 +1,198 @@
+#include "treegen.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const std::uint32_t kSeed = 20250329;
+
+/// Создание деревьев с подсчётом того, что создано
+class TreeBuilder {
+public:
+    TreeBuilder(TreeInfo &info) : info(info), rng(kSeed) {}
+
+    void dir(const fs::path &path) {
+        std::error_code ec;
+        if (fs::create_directory(path, ec)) info.dirs++;
+    }
+
+    void file(const fs::path &path, std::uint64_t size) {
+        static const std::vector<char> fill(64 * 1024, 'k');
+        std::FILE *out = std::fopen(path.string().c_str(), "wb");
+        if (!out) return;
+        for (std::uint64_t left = size; left > 0;) {
+            size_t chunk = static_cast<size_t>(std::min<std::uint64_t>(left, fill.size()));
+            std::fwrite(fill.data(), 1, chunk, out);
+            left -= chunk;
+        }
+        std::fclose(out);
+        info.files++;
+        info.bytes += size;
+    }
+
+    void link(const fs::path &target, const fs::path &path) {
+        std::error_code ec;
+        fs::create_hard_link(target, path, ec);
+        if (!ec) info.links++;
+    }
+
+    /// Размер в [0, max): сырые значения mt19937 одинаковы на всех платформах,
+    /// в отличие от std::uniform_int_distribution
+    std::uint64_t size(std::uint64_t max) {
+        return max == 0 ? 0 : rng() % max;
+    }
+
+private:
+    TreeInfo &info;
+    std::mt19937 rng;
+};
+
+std::uint64_t scaled(std::uint64_t base, double scale) {
+    double n = static_cast<double>(base) * scale;
+    return n < 1 ? 1 : static_cast<std::uint64_t>(n + 0.5);
+}
+
+std::string numbered(const char *prefix, std::uint64_t n) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%s%06llu", prefix, static_cast<unsigned long long>(n));
+    return buffer;
+}
+
+void wideFlat(TreeBuilder &tree, const fs::path &root, double scale) {
+    std::uint64_t count = scaled(100000, scale);
+    for (std::uint64_t i = 0; i < count; ++i) tree.file(root / numbered("f", i), tree.size(1024));
+}
+
+void deepNarrow(TreeBuilder &tree, const fs::path &root, double scale) {
+    // Глубина ограничена длиной пути (PATH_MAX): растёт только число файлов на уровне
+    const std::uint64_t depth = 300;
+    std::uint64_t perLevel = scaled(8, scale);
+    fs::path dir = root;
+    for (std::uint64_t level = 0; level < depth; ++level) {
+        for (std::uint64_t i = 0; i < perLevel; ++i) tree.file(dir / numbered("f", i), tree.size(4096));
+        dir /= "d";
+        tree.dir(dir);
+    }
+}
+
+void tinyFiles(TreeBuilder &tree, const fs::path &root, double scale) {
+    std::uint64_t dirs = scaled(1000, scale);
+    for (std::uint64_t d = 0; d < dirs; ++d) {
+        fs::path dir = root / numbered("pkg", d);
+        tree.dir(dir);
+        for (std::uint64_t i = 0; i < 200; ++i) tree.file(dir / numbered("m", i), tree.size(512));
+    }
+}
+
+void hardlinked(TreeBuilder &tree, const fs::path &root, double scale) {
+    // Хранилище с раскладкой по первым символам хэша и проекты, где node_modules
+    // состоит из жёстких ссылок на хранилище
+    fs::path store = root / "store" / "v3" / "files";
+    tree.dir(root / "store");
+    tree.dir(root / "store" / "v3");
+    tree.dir(store);
+    std::vector<fs::path> stored;
+    std::uint64_t perBucket = scaled(40, scale);
+    for (unsigned bucket = 0; bucket < 256; ++bucket) {
+        char name[3];
+        std::snprintf(name, sizeof(name), "%02x", bucket);
+        fs::path dir = store / name;
+        tree.dir(dir);
+        for (std::uint64_t i = 0; i < perBucket; ++i) {
+            stored.push_back(dir / numbered("h", i));
+            tree.file(stored.back(), tree.size(8192));
+        }
+    }
+    const unsigned projects = 8;
+    for (unsigned p = 0; p < projects; ++p) {
+        fs::path modules = root / numbered("project", p) / "node_modules";
+        tree.dir(modules.parent_path());
+        tree.dir(modules);
+        for (size_t i = p; i < stored.size(); i += 4) {
+            fs::path pkg = modules / numbered("pkg", i / 16);
+            tree.dir(pkg);
+            tree.link(stored[i], pkg / stored[i].filename());
+        }
+    }
+}
+
+void firefox(TreeBuilder &tree, const fs::path &root, double scale) {
+    static const char *const kProfileFiles[] = {
+        "places.sqlite", "cookies.sqlite", "prefs.js", "cert9.db", "key4.db", "favicons.sqlite"
+    };
+    std::uint64_t profiles = scaled(40, scale);
+    fs::path base = root / "Profiles";
+    tree.dir(base);
+    for (std::uint64_t p = 0; p < profiles; ++p) {
+        fs::path profile = base / (numbered("x", p) + ".default-release");
+        tree.dir(profile);
+        for (const char *name : kProfileFiles) tree.file(profile / name, tree.size(65536));
+        tree.dir(profile / "storage");
+        for (unsigned i = 0; i < 24; ++i) tree.file(profile / "storage" / numbered("s", i), tree.size(4096));
+        fs::path cache = profile / "cache2";
+        tree.dir(cache);
+        tree.dir(cache / "entries");
+        tree.dir(cache / "doomed");
+        for (unsigned i = 0; i < 1000; ++i) tree.file(cache / "entries" / numbered("E", i), tree.size(16384));
+        for (unsigned i = 0; i < 10; ++i) tree.file(cache / "doomed" / numbered("D", i), tree.size(16384));
+    }
+}
+
+} // namespace
+
+const char *layoutName(TREE_LAYOUT layout) {
+    switch (layout) {
+    case TREE_LAYOUT::WIDE_FLAT: return "wide_flat";
+    case TREE_LAYOUT::DEEP_NARROW: return "deep_narrow";
+    case TREE_LAYOUT::TINY_FILES: return "tiny_files";
+    case TREE_LAYOUT::HARDLINKED: return "hardlinked";
+    case TREE_LAYOUT::FIREFOX: return "firefox";
+    }
+    return "unknown";
+}
+
+TreeInfo generateTree(TREE_LAYOUT layout, const std::string &root, double scale) {
+    TreeInfo info;
+    info.root = root;
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    fs::create_directories(root, ec);
+
+    TreeBuilder tree(info);
+    fs::path base(root);
+    switch (layout) {
+    case TREE_LAYOUT::WIDE_FLAT: wideFlat(tree, base, scale); break;
+    case TREE_LAYOUT::DEEP_NARROW: deepNarrow(tree, base, scale); break;
+    case TREE_LAYOUT::TINY_FILES: tinyFiles(tree, base, scale); break;
+    case TREE_LAYOUT::HARDLINKED: hardlinked(tree, base, scale); break;
+    case TREE_LAYOUT::FIREFOX: firefox(tree, base, scale); break;
+    }
+
+    if (layout == TREE_LAYOUT::FIREFOX) {
+        info.targets.push_back((base / "Profiles" / "*" / "cache2").string());
+        for (std::uint64_t p = 0; p < scaled(40, scale); ++p) {
+            info.paths.push_back((base / "Profiles" / (numbered("x", p) + ".default-release") / "cache2").string());
+        }
+    } else if (layout == TREE_LAYOUT::HARDLINKED) {
+        for (unsigned p = 0; p < 8; ++p) {
+            info.targets.push_back((base / numbered("project", p) / "node_modules").string());
+        }
+        info.paths = info.targets;
+    } else {
+        info.targets.push_back(root);
+        info.paths = info.targets;
+    }
+    return info;
+}
+
+std::string defaultBenchDir() {
+    std::error_code ec;
+    if (fs::is_directory("/dev/shm", ec)) return "/dev/shm";
+    return fs::temp_directory_path(ec).string();
+}
@@ -0,0 +1,39 @@
+#ifndef TREEGEN_H
+#define TREEGEN_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Форма синтетического дерева
+enum class TREE_LAYOUT {
+    WIDE_FLAT,      // Одна директория с большим числом файлов
+    DEEP_NARROW,    // Длинная цепочка вложенных директорий, по несколько файлов на уровне
+    TINY_FILES,     // Много директорий с мелкими файлами (кэши пакетных менеджеров)
+    HARDLINKED,     // Хранилище и проекты с жёсткими ссылками на него (pnpm)
+    FIREFOX         // Profiles/*/cache2 среди других файлов профилей
+};
+
+/// Что получилось после генерации
+struct TreeInfo {
+    std::string root;
+    std::uint64_t files = 0;
+    std::uint64_t dirs = 0;
+    std::uint64_t links = 0;            // Дополнительные жёсткие ссылки
+    std::uint64_t bytes = 0;
+    std::vector<std::string> targets;   // Цели очистки как в конфиге (могут быть шаблонами)
+    std::vector<std::string> paths;     // Те же цели, развёрнутые в конкретные пути
+};
+
+/// Имя формы для вывода и фильтра бенчмарков
+const char *layoutName(TREE_LAYOUT layout);
+
+/// Построение дерева под root (директория пересоздаётся). Содержимое зависит только
+/// от формы и scale: генератор с фиксированным зерном, без времени и случайных имён.
+/// scale = 1 — десятки-сотни тысяч элементов, размеры форм растут линейно.
+TreeInfo generateTree(TREE_LAYOUT layout, const std::string &root, double scale);
+
+/// Каталог для деревьев по умолчанию: tmpfs (/dev/shm), если есть, иначе временный
+std::string defaultBenchDir();
+
+#endif // TREEGEN_H
@@ -1,5 +1,10 @@
 #include "cleaner.h"
+#include "glob.h"
 #include "logger.h"
+#include "pathlookup.h"
+#include "profile.h"
+#include "scancache.h"
+#include "trash.h"
 #include "utils.h"
 
 #include <filesystem>
@@ -7,11 +12,14 @@
 #include <vector>
 #include <algorithm>
 #include <cctype>
-#include <set>
-#include <sstream>
-#include <iomanip>
 #include <cstdlib>
 #include <iostream>
+#include <map>
+#include <memory>
+
+#ifndef _WIN32
+#include <climits>      // PATH_MAX
+#endif
 
 namespace fs = std::filesystem;
 
@@ -32,131 +40,11 @@ static std::string toLowerStr(std::string s) {
     return s;
 }
 
-static bool hasWildcard(const std::string &s) {
-    return s.find('*') != std::string::npos || s.find('?') != std::string::npos;
-}
-
-static bool wildcardMatch(const std::string &text, const std::string &pattern) {
-    size_t t = 0;
-    size_t p = 0;
-    size_t star = std::string::npos;
-    size_t match = 0;
-    while (t < text.size()) {
-        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == text[t])) {
-            ++t;
-            ++p;
-        } else if (p < pattern.size() && pattern[p] == '*') {
-            star = p++;
-            match = t;
-        } else if (star != std::string::npos) {
-            p = star + 1;
-            t = ++match;
-        } else {
-            return false;
-        }
-    }
-    while (p < pattern.size() && pattern[p] == '*') ++p;
-    return p == pattern.size();
-}
-
 static std::string normalizeSeparators(std::string path) {
     std::replace(path.begin(), path.end(), '\\', '/');
     return path;
 }
 
-static std::vector<std::string> splitSegments(const std::string &path, size_t start) {
-    std::vector<std::string> segs;
-    std::string current;
-    for (size_t i = start; i < path.size(); ++i) {
-        char c = path[i];
-        if (c == '/') {
-            if (!current.empty()) {
-                segs.push_back(current);
-                current.clear();
-            }
-        } else {
-            current.push_back(c);
-        }
-    }
-    if (!current.empty()) segs.push_back(current);
-    return segs;
-}
-
-static void expandGlobRecursive(const fs::path &base,
-                                const std::vector<std::string> &segs,
-                                size_t index,
-                                std::vector<std::string> &out) {
-    if (index >= segs.size()) {
-        out.push_back(base.string());
-        return;
-    }
-    const std::string &seg = segs[index];
-    bool wildcard = hasWildcard(seg);
-    if (!wildcard) {
-        fs::path next = base / seg;
-        std::error_code ec;
-        if (!fs::exists(next, ec)) return;
-        if (index + 1 < segs.size() && !fs::is_directory(next, ec)) return;
-        expandGlobRecursive(next, segs, index + 1, out);
-        return;
-    }
-    std::error_code ec;
-    if (!fs::exists(base, ec) || !fs::is_directory(base, ec)) return;
-    for (auto it = fs::directory_iterator(base, fs::directory_options::skip_permission_denied);
-         it != fs::directory_iterator(); ++it) {
-        std::string name = it->path().filename().string();
-        if (!wildcardMatch(name, seg)) continue;
-        fs::path next = it->path();
-        if (index + 1 < segs.size() && !it->is_directory(ec)) continue;
-        expandGlobRecursive(next, segs, index + 1, out);
-    }
-}
-
-static std::vector<std::string> expandGlob(const std::string &pattern) {
-    std::vector<std::string> results;
-    std::string norm = normalizeSeparators(pattern);
-    fs::path base;
-    size_t start = 0;
-    if (norm.size() >= 3 && std::isalpha(static_cast<unsigned char>(norm[0])) &&
-        norm[1] == ':' && norm[2] == '/') {
-        base = norm.substr(0, 3);
-        start = 3;
-    } else if (!norm.empty() && norm[0] == '/') {
-        base = "/";
-        start = 1;
-    } else {
-        base = ".";
-        start = 0;
-    }
-    std::vector<std::string> segs = splitSegments(norm, start);
-    expandGlobRecursive(base, segs, 0, results);
-    std::set<std::string> unique(results.begin(), results.end());
-    return std::vector<std::string>(unique.begin(), unique.end());
-}
-
-static std::string formatSize(uintmax_t bytes) {
-    const double mb = 1024.0 * 1024.0;
-    const double gb = mb * 1024.0;
-    std::ostringstream out;
-    out.setf(std::ios::fixed);
-    out << std::setprecision(2);
-    if (bytes >= static_cast<uintmax_t>(gb)) {
-        out << (bytes / gb) << " GB";
-    } else {
-        out << (bytes / mb) << " MB";
-    }
-    return out.str();
-}
-
-static bool commandExistsLocal(const std::string &cmd) {
-#ifdef _WIN32
-    std::string check = "where " + cmd + " >nul 2>&1";
-#else
-    std::string check = "command -v " + cmd + " >/dev/null 2>&1";
-#endif
-    return std::system(check.c_str()) == 0;
-}
-
 #ifndef _WIN32
 static std::string shellEscape(const std::string &input) {
     std::string out;
@@ -174,8 +62,12 @@ static std::string shellEscape(const std::string &input) {
 }
 #endif
 
-Cleaner::Cleaner(const Config &config) : config(config) {
+Cleaner::Cleaner(const Config &config, const EnvContext &env) : config(config), env(env) {
     buildTargetPaths();
+    if ((config.useCacheSet || config.rebuildCache) && (entriesNeeded() || config.inodeAccounting)) {
+        LOG_WARNING("--no-cache / --rebuild-cache не действуют: при удалении в режиме snapshot, очистке до цели "
+                    "и --inode-accounting кэш сканирования не используется");
+    }
 }
 
 static std::vector<PathEntry> defaultWindowsEntries() {
@@ -262,7 +154,13 @@ static bool isWindowsSystemEntry(const PathEntry &entry) {
 }
 
 void Cleaner::buildTargetPaths() {
+    PROFILE_SCOPE("Cleaner::buildTargetPaths");
     targets.clear();
+    interned.clear();
+    strings = PathArena();
+    snapshot.clear();
+    scanned = false;
+    snapshotEntries = false;
     bool includeWindows = config.targetOS == OS_TYPE::WINDOWS || config.targetOS == OS_TYPE::BOTH;
     bool includeLinux = config.targetOS == OS_TYPE::LINUX || config.targetOS == OS_TYPE::BOTH;
     if (config.targetOS == OS_TYPE::AUTO) {
@@ -303,55 +201,236 @@ void Cleaner::buildTargetPaths() {
         entry.value = path;
         addTargetGroup("Extra", entry, false);
     }
+    resolvePatterns();
+    resolveOverlaps();
 }
 
-/// Подсчет количества файлов, папок и общего размера перед удалением
-std::tuple<size_t, size_t, double> Cleaner::countItemsToDelete() {
-    size_t fileCount = 0, dirCount = 0;
-    uintmax_t totalSize = 0;
+namespace {
 
-    for (const auto &group : targets) {
-        for (const auto &path : group.paths) {
-            if (!pathExists(path)) continue;
-            if (path.find("systemd-private") != std::string::npos) continue;
+/// Узел дерева префиксов канонических путей (по компонентам)
+struct PathTrieNode {
+    std::map<std::string, std::unique_ptr<PathTrieNode>, std::less<>> children;
+    std::string_view owner; // Путь цели, которой принадлежит узел (в записи этой цели)
+    bool owned = false;
+};
 
-            std::error_code ec;
-            fs::path root(path);
-            if (fs::is_regular_file(root, ec)) {
-                std::string name = root.filename().string();
-                if (!config.includeHidden && !name.empty() && name.front() == '.') continue;
-                fileCount++;
-                totalSize += fs::file_size(root, ec);
+/// Канонический путь в виде с '/' и длина его корня. Существующий путь на POSIX
+/// разрешается одним realpath(), без разбора по компонентам в std::filesystem
+std::string canonicalPath(std::string_view path, size_t &rootSize) {
+#ifndef _WIN32
+    char resolved[PATH_MAX];
+    if (::realpath(std::string(path).c_str(), resolved)) {
+        rootSize = 1;
+        return resolved;
+    }
+#endif
+    std::error_code ec;
+    fs::path canonical = fs::weakly_canonical(fs::path(path), ec);
+    if (ec) canonical = fs::path(path).lexically_normal();
+    rootSize = canonical.has_root_path() ? canonical.root_path().generic_string().size() : 0;
+    return canonical.generic_string();
+}
+
+/// Узел канонического пути (корень, затем имена), недостающие узлы создаются.
+/// Имена ищутся по string_view: строка ключа выделяется только для нового узла.
+PathTrieNode *trieNode(PathTrieNode &root, std::string_view path) {
+    size_t start = 0;
+    std::string text = canonicalPath(path, start);
+
+    auto child = [](PathTrieNode *node, std::string_view name) {
+        auto it = node->children.find(name);
+        if (it == node->children.end()) {
+            it = node->children.emplace(std::string(name), std::make_unique<PathTrieNode>()).first;
+        }
+        return it->second.get();
+    };
+    PathTrieNode *node = &root;
+    std::string_view rest(text);
+    if (start > 0) node = child(node, rest.substr(0, start));
+    while (start < rest.size()) {
+        size_t slash = rest.find('/', start);
+        if (slash == std::string_view::npos) slash = rest.size();
+        std::string_view name = rest.substr(start, slash - start);
+        if (!name.empty() && name != ".") node = child(node, name);
+        start = slash + 1;
+    }
+    return node;
+}
+
+/// Ближайшие вложенные цели под узлом-владельцем становятся исключениями его обхода.
+/// Путь исключения строится от пути владельца, как его строит обходчик.
+void collectExclusions(const PathTrieNode &node, const std::string &walkPath,
+                       std::unordered_set<std::string> &excluded) {
+    for (const auto &child : node.children) {
+        std::string childPath = joinPath(walkPath, child.first);
+        if (child.second->owned) {
+            excluded.insert(childPath);
+        } else {
+            collectExclusions(*child.second, childPath, excluded);
+        }
+    }
+}
+
+void collectOwners(const PathTrieNode &node, std::unordered_set<std::string> &excluded) {
+    for (const auto &child : node.children) {
+        if (child.second->owned) {
+            collectExclusions(*child.second, std::string(child.second->owner), excluded);
+        }
+        collectOwners(*child.second, excluded);
+    }
+}
+
+} // namespace
+
+void Cleaner::resolveOverlaps() {
+    PROFILE_SCOPE("Cleaner::resolveOverlaps");
+    excludedPaths.clear();
+    PathTrieNode root;
+    for (auto &group : targets) {
+        size_t kept = 0;
+        for (std::string_view path : group.paths) {
+            PathTrieNode *node = trieNode(root, path);
+            if (node->owned) {
+                // Тот же физический путь уже принадлежит более ранней группе
+                LOG_DEBUG(concat({"Путь уже входит в другую цель: ", path, " (", node->owner, ")"}));
                 continue;
             }
+            node->owned = true;
+            node->owner = path;
+            group.paths[kept++] = path;
+        }
+        group.paths.resize(kept);
+    }
+    // Служебная директория (кэш сканирования, корзина, статус) лежит в ~/.cache, то есть
+    // внутри обычной цели: её не обходят, не считают и не удаляют, как вложенную цель
+    std::string service = serviceDirectory(env);
+    PathTrieNode *serviceNode = trieNode(root, service);
+    if (!serviceNode->owned) {
+        serviceNode->owned = true;
+        serviceNode->owner = service;
+    }
+    collectOwners(root, excludedPaths);
+    std::vector<std::string> sorted(excludedPaths.begin(), excludedPaths.end());
+    std::sort(sorted.begin(), sorted.end());
+    for (const auto &path : sorted) {
+        LOG_DEBUG("Вложенная цель исключена из обхода родительской: " + path);
+    }
+}
 
-            try {
-                for (auto it = fs::recursive_directory_iterator(
-                             path, fs::directory_options::skip_permission_denied);
-                     it != fs::recursive_directory_iterator(); ++it) {
-                    const fs::path &p = it->path();
-                    if (p.string().find("systemd-private") != std::string::npos) {
-                        it.disable_recursion_pending();
-                        continue;
-                    }
-                    std::string name = p.filename().string();
-                    if (!config.includeHidden && !name.empty() && name.front() == '.')
-                        continue;
-
-                std::error_code ec;
-                if (it->is_directory(ec)) {
-                    if (!ec) dirCount++;
-                } else if (it->is_regular_file(ec)) {
-                    if (!ec) {
-                        fileCount++;
-                        std::error_code sizeEc;
-                        totalSize += it->file_size(sizeEc);
-                    }
-                }
-            }
-            } catch (const fs::filesystem_error &e) {
-                LOG_WARNING("Отказ в доступе к " + path + ": " + e.what());
+bool Cleaner::cacheEnabled() const {
+    // Учёт по inode требует всех ссылок разом, кэш по директориям его не заменит
+    return config.useCache && !config.inodeAccounting;
+}
+
+bool Cleaner::entriesNeeded() const {
+    // Для очистки до цели нужны все файлы с временем доступа, итогов из кэша мало.
+    // План по кэшу перед удалением по снимку означал бы второй обход после подтверждения;
+    // --dry-run выводит элементы потоковым обходом, --plan элементы не выводит
+    return quotaMode() || (!streamingDelete() && !config.dryRun && !config.planOnly);
+}
+
+/// Свёртка параметров обхода (FNV-1a): при их смене записи кэша недействительны
+static std::uint64_t scanFingerprint(const Config &config, const std::unordered_set<std::string> &excluded) {
+    std::uint64_t hash = 1469598103934665603ULL;
+    auto mix = [&hash](const std::string &text) {
+        for (unsigned char c : text) {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        hash ^= 0xFF;
+        hash *= 1099511628211ULL;
+    };
+    mix(config.includeHidden ? "hidden" : "visible");
+    mix(config.trash ? "trash" : "in-place");
+    mix(ioBackendName(currentIoBackend()));
+    std::vector<std::string> sorted(excluded.begin(), excluded.end());
+    std::sort(sorted.begin(), sorted.end());
+    for (const auto &path : sorted) mix(path);
+    return hash;
+}
+
+/// Однократное сканирование всех целей
+void Cleaner::scan() {
+    PROFILE_SCOPE("Cleaner::scan");
+    // Без кэша элементы снимка собираются тем же обходом, что и итоги
+    bool keepEntries = entriesNeeded() || (!streamingDelete() && !cacheEnabled());
+    if (scanned) return;
+    ScanOptions options;
+    options.includeHidden = config.includeHidden;
+    options.jobs = config.jobs;
+    // В потоковом режиме удаление само обходит дерево, снимок хранит только итоги
+    options.keepEntries = keepEntries;
+    options.excluded = &excludedPaths;
+    options.inodeAccounting = config.inodeAccounting;
+    options.memoryBudget = config.maxMemory;
+
+    std::unique_ptr<ScanCache> cache;
+    std::string cachePath;
+    if (!keepEntries && cacheEnabled()) {
+        cachePath = config.cacheFile.empty() ? ScanCache::defaultPath() : config.cacheFile;
+        cache = std::make_unique<ScanCache>(scanFingerprint(config, excludedPaths));
+        if (!config.rebuildCache && cache->load(cachePath)) {
+            LOG_DEBUG("Загружен кэш сканирования: " + cachePath + " (" +
+                      std::to_string(cache->loadedCount()) + " директорий)");
+        }
+        options.cache = cache.get();
+    }
+
+    // Все пути всех групп обходятся одним пулом потоков
+    std::vector<std::string> allPaths;
+    std::vector<const RetentionFilter *> filters;
+    std::vector<bool> hidden;
+    for (size_t i = 0; i < targets.size(); ++i) {
+        for (std::string_view path : targets[i].paths) {
+            allPaths.emplace_back(path);
+            hidden.push_back(trashTarget(path, i));
+        }
+        filters.insert(filters.end(), targets[i].paths.size(), targets[i].filter);
+    }
+    options.filters = &filters;
+    options.hiddenPaths = &hidden;
+    std::vector<PathScan> scans = scanPaths(allPaths, options);
+
+    snapshot.clear();
+    snapshot.resize(targets.size());
+    size_t next = 0;
+    for (size_t i = 0; i < targets.size(); ++i) {
+        GroupScan &groupScan = snapshot[i];
+        groupScan.paths.reserve(targets[i].paths.size());
+        for (size_t j = 0; j < targets[i].paths.size(); ++j) {
+            groupScan.paths.push_back(std::move(scans[next++]));
+            const PathScan &pathScan = groupScan.paths.back();
+            groupScan.bytes += pathScan.bytes;
+            groupScan.diskBytes += pathScan.diskBytes;
+            groupScan.reclaimableBytes += pathScan.reclaimableBytes;
+        }
+    }
+    scanned = true;
+    snapshotEntries = keepEntries;
+
+    if (cache) {
+        LOG_DEBUG("Кэш сканирования: без изменений " + std::to_string(cache->hitCount()) + " директорий");
+        if (!cache->save(cachePath)) {
+            LOG_WARNING("Не удалось сохранить кэш сканирования: " + cachePath);
+        }
+    }
+}
+
+/// Подсчет количества файлов, папок и общего размера перед удалением
+std::tuple<size_t, size_t, double> Cleaner::countItemsToDelete() {
+    PROFILE_SCOPE("Cleaner::countItemsToDelete");
+    scan();
+    size_t fileCount = 0, dirCount = 0;
+    uintmax_t totalSize = 0;
+
+    for (const auto &groupScan : snapshot) {
+        for (const auto &pathScan : groupScan.paths) {
+            if (!pathScan.error.empty()) {
+                LOG_WARNING("Отказ в доступе к " + pathScan.path + ": " + pathScan.error);
             }
+            fileCount += pathScan.files;
+            dirCount += pathScan.dirs;
+            totalSize += pathScan.bytes;
         }
     }
 
@@ -360,137 +439,431 @@ std::tuple<size_t, size_t, double> Cleaner::countItemsToDelete() {
 
 
 /// Запуск процесса очистки
-void Cleaner::run() {
+void Cleaner::run(const std::vector<bool> &selected) {
+    PROFILE_SCOPE("Cleaner::run");
     deniedPaths.clear();
     LOG_INFO("Запуск очистки:");
-    for (const auto &group : targets) {
-        LOG_INFO(" -> " + group.scope + " / " + group.name);
+    for (size_t i = 0; i < targets.size(); ++i) {
+        if (!selected.empty() && !selected[i]) continue;
+        const TargetGroup &group = targets[i];
+        LOG_INFO(concat({" -> ", group.scope, " / ", group.name}));
         if (config.verbose) {
-            for (const auto &path : group.paths) {
-                LOG_INFO("    " + path);
+            for (std::string_view path : group.paths) {
+                LOG_INFO(concat({"    ", path}));
             }
         }
     }
 
-    for (const auto &group : targets) {
-        for (const auto &path : group.paths) {
-            processPath(path);
+    scan();
+    if (profile::available()) {
+        std::vector<std::string> names;
+        for (const auto &group : targets) names.push_back(concat({group.scope, " / ", group.name}));
+        profile::setGroups(names);
+    }
+    DeleteOptions deleteOptions;
+    deleteOptions.jobs = config.jobs;
+    deleteOptions.maxInFlight = config.maxInFlight;
+    deleteOptions.maxOpsPerSec = config.maxUnlinkRate;
+    deleteOptions.maxBytesPerSec = config.maxFreeRate;
+    deleteOptions.includeHidden = config.includeHidden;
+    deleteOptions.dryRun = config.dryRun;
+    deleteOptions.excluded = &excludedPaths;
+    {
+        Deleter deleter(deleteOptions, [this](const ScanEntry &entry, const std::string &path, size_t group,
+                                              bool removed, const std::error_code &ec) {
+            reportDeletion(entry, path, group, removed, ec);
+        });
+        if (quotaMode()) {
+            runQuota(deleter, selected);
+        } else {
+            for (size_t i = 0; i < snapshot.size(); ++i) {
+                if (!selected.empty() && !selected[i]) continue;
+                for (const auto &pathScan : snapshot[i].paths) {
+                    processPath(pathScan, deleter, i);
+                }
+            }
+        }
+        deleter.wait();
+    }
+    if (config.trash && !config.dryRun && trashPending()) {
+        std::string error;
+        if (startTrashPurge(config, error)) {
+            LOG_INFO("Корзина удаляется в фоне, место освобождается по мере удаления");
+        } else {
+            LOG_WARNING("Не удалось запустить фоновое удаление корзины: " + error +
+                        ". Оно продолжится при следующем запуске (или --purge-trash).");
         }
     }
 
-    if (!deniedPaths.empty()) {
-        LOG_WARNING("Не удалось очистить " + std::to_string(deniedPaths.size()) + " путей из-за прав доступа.");
-        if (config.verbose) {
-            for (const auto &p : deniedPaths) {
-                LOG_WARNING("    " + p);
-            }
+    reportDenied();
+}
+
+void Cleaner::reportDenied() {
+    std::vector<std::pair<std::string, DeniedPath>> denied = deniedList();
+    if (denied.empty()) return;
+    std::map<std::error_code, std::uint64_t> byError;
+    for (const auto &item : denied) byError[item.second.error]++;
+    std::map<std::string, std::vector<size_t>> byTarget = deniedByTarget(denied);
+
+    LOG_WARNING("Не удалось очистить " + std::to_string(denied.size()) + " путей.");
+    for (const auto &reason : byError) {
+        LOG_WARNING("    " + reason.first.message() + ": " + std::to_string(reason.second));
+    }
+    for (const auto &target : byTarget) {
+        LOG_WARNING("    в " + target.first + ": " + std::to_string(target.second.size()));
+    }
+    if (config.verbose) {
+        for (const auto &item : denied) {
+            LOG_WARNING("    " + item.first + " (" + item.second.error.message() + ")");
         }
+    }
 #ifndef _WIN32
-        if (config.allowSudo && !config.dryRun) {
-            if (!commandExistsLocal("sudo")) {
-                LOG_WARNING("sudo не найден");
-                return;
+    if (!config.allowSudo || config.dryRun) return;
+    // sudo помогает только при отказе в правах; пути, вложенные в уже повторяемые,
+    // удалятся вместе с ними
+    std::map<std::string, std::vector<std::string>> retry;
+    size_t retryCount = 0;
+    for (const auto &target : byTarget) {
+        std::vector<std::string> paths;
+        for (size_t index : target.second) {
+            const auto &item = denied[index];
+            if (item.second.error != std::errc::permission_denied &&
+                item.second.error != std::errc::operation_not_permitted) continue;
+            const std::string &path = item.first;
+            if (!paths.empty() && path.compare(0, paths.back().size(), paths.back()) == 0 &&
+                (path.size() == paths.back().size() || path[paths.back().size()] == '/')) continue;
+            paths.push_back(path);
+        }
+        if (paths.empty()) continue;
+        retryCount += paths.size();
+        retry[target.first] = std::move(paths);
+    }
+    if (retry.empty()) return;
+    std::string sudo = findExecutable("sudo");
+    if (sudo.empty()) {
+        LOG_WARNING("sudo не найден");
+        return;
+    }
+    flushLogger();
+    std::cout << "Повторить удаление с sudo для " << retryCount << " путей в " << retry.size()
+              << " целях? (y/n): ";
+    std::string answer;
+    std::getline(std::cin, answer);
+    if (answer != "y" && answer != "Y") {
+        LOG_INFO("sudo очистка отменена пользователем.");
+        return;
+    }
+    // Одна команда на цель; длинные списки делятся, чтобы не превысить ARG_MAX
+    const size_t kMaxCommand = 64 * 1024;
+    std::string prefix = shellEscape(sudo) + " rm -rf --";
+    for (const auto &target : retry) {
+        const std::vector<std::string> &paths = target.second;
+        for (size_t begin = 0; begin < paths.size();) {
+            std::string cmd = prefix;
+            size_t end = begin;
+            while (end < paths.size() && (end == begin || cmd.size() + paths[end].size() + 3 < kMaxCommand)) {
+                cmd.push_back(' ');
+                cmd += shellEscape(paths[end++]);
             }
-            std::cout << "Повторить удаление с sudo для этих путей? (y/n): ";
-            std::string answer;
-            std::getline(std::cin, answer);
-            if (answer == "y" || answer == "Y") {
-                for (const auto &p : deniedPaths) {
-                    std::string cmd = "sudo rm -rf -- " + shellEscape(p);
-                    int code = std::system(cmd.c_str());
-                    if (code != 0) {
-                        LOG_WARNING("sudo удаление не удалось: " + p);
-                    } else {
-                        LOG_INFO("sudo удалено: " + p);
-                    }
-                }
+            std::string what = target.first + " (" + std::to_string(end - begin) + " путей)";
+            if (std::system(cmd.c_str()) != 0) {
+                LOG_WARNING("sudo удаление не удалось: " + what);
             } else {
-                LOG_INFO("sudo очистка отменена пользователем.");
+                LOG_INFO("sudo удалено: " + what);
             }
+            begin = end;
         }
-#else
-        (void)commandExistsLocal;
+    }
 #endif
+}
+
+/// Есть ли среди путей других целей вложенные в root
+static bool containsExcluded(const std::string &root, const std::unordered_set<std::string> &excluded) {
+    for (const auto &path : excluded) {
+        if (path.size() > root.size() && path.compare(0, root.size(), root) == 0 &&
+            (path[root.size()] == '/' || root.back() == '/')) {
+            return true;
+        }
     }
+    return false;
 }
 
-/// Рекурсивная обработка одного пути
-/// Рекурсивная обработка одного пути
-void Cleaner::processPath(const std::string &path) {
-    if (!pathExists(path)) {
-        LOG_DEBUG("Путь не существует: " + path);
+/// Обработка одного пути по данным снимка
+void Cleaner::processPath(const PathScan &scan, Deleter &deleter, size_t group) {
+    PROFILE_SCOPE("Cleaner::processPath");
+    if (!scan.exists) {
+        LOG_DEBUG("Путь не существует: " + scan.path);
         return;
     }
     
-    if (path.find("systemd-private") != std::string::npos) {
-        LOG_DEBUG("Пропущен защищённый системный путь: " + path);
+    if (scan.protectedPath) {
+        LOG_DEBUG("Пропущен защищённый системный путь: " + scan.path);
         return;
     }
-    
-    try {
-        std::error_code ec;
-        if (fs::is_regular_file(path, ec)) {
-            if (config.dryRun) {
-                LOG_INFO("[Dry Run] Будет удалено: " + path);
-            } else {
-                deleteEntry(path);
-            }
+
+    if (!scan.error.empty()) {
+        if (scan.denied) {
+            LOG_WARNING("Отказ в доступе к " + scan.path + ". Пропускаем.");
+            addDeniedPath(scan.path, std::make_error_code(std::errc::permission_denied), group);
+        } else {
+            LOG_ERROR("Ошибка доступа к " + scan.path + ": " + scan.error);
+        }
+        return;
+    }
+
+    // Корзина: цель освобождается переименованием, деревья удаляет фоновый процесс
+    bool trash = trashTarget(scan.path, group);
+    if (trash && !scan.regularFile) {
+        if (config.dryRun) {
+            LOG_INFO("[Dry Run] Будет перемещено в корзину: " + scan.path);
             return;
         }
+        std::string error;
+        if (stageToTrash(scan.path, config, excludedPaths, error)) {
+            removedFiles += scan.files;
+            removedDirs += scan.dirs;
+            freedBytes += scan.bytes;
+            LOG_INFO("Перемещено в корзину: " + scan.path + " (" + formatSize(scan.bytes) + ")");
+            return;
+        }
+        LOG_WARNING("Не удалось переместить в корзину " + scan.path + ": " + error + ". Удаляем на месте.");
+    }
+
+    // С фильтром удаляется только отобранное при сканировании, поэтому и в потоковом
+    // режиме используются элементы снимка. Снимок из итогов кэша (--dry-run) выводится
+    // потоковым обходом
+    if ((streamingDelete() || !snapshotEntries) && !scan.regularFile && !targets[group].filter) {
+        deleter.addStream(scan.path, group, trash);
+        return;
+    }
+
+    if (config.dryRun) {
+        // Элементы записаны в порядке обхода, поэтому выводим с конца: дети раньше родителей
+        for (size_t i = scan.entries.size(); i-- > 0;) {
+            LOG_INFO("[Dry Run] Будет удалено: " + entryPath(scan, i));
+        }
+        return;
+    }
+    deleter.add(scan, group);
+}
+
+
+bool Cleaner::trashTarget(std::string_view path, size_t group) const {
+    // Вложенные цели других групп переносить нельзя, с фильтром и при очистке до цели
+    // удаляется не всё
+    if (!config.trash || quotaMode() || targets[group].filter) return false;
+    std::string text(path);
+    return trashAllowed(text) && !containsExcluded(text, excludedPaths);
+}
+
+bool Cleaner::quotaMode() const {
+    return config.freeTarget > 0 || config.freeUntil > 0;
+}
+
+bool Cleaner::streamingDelete() const {
+    return config.deleteMode == DELETE_MODE::STREAMING || config.maxMemory > 0;
+}
 
-        std::vector<fs::path> entries;
-        for (auto it = fs::recursive_directory_iterator(
-                     path, fs::directory_options::skip_permission_denied);
-             it != fs::recursive_directory_iterator(); ++it) {
-            const fs::path &p = it->path();
-            if (p.string().find("systemd-private") != std::string::npos) {
-                it.disable_recursion_pending();
+namespace {
+
+/// Файл-кандидат при очистке до цели
+struct QuotaCandidate {
+    double score;               // Давность доступа с весом группы: больше — удаляется раньше
+    std::uint32_t group;
+    std::uint32_t path;
+    size_t entry;
+    std::uint64_t fs;           // Идентификатор ФС корня пути
+
+    bool operator<(const QuotaCandidate &other) const { return score < other.score; }
+};
+
+/// Файловая система целей: место в начале очистки и сейчас
+struct QuotaFs {
+    std::string path;           // Любой корень цели на этой ФС (для повторного statvfs)
+    DiskSpace start;
+    DiskSpace current;
+};
+
+} // namespace
+
+/// Очистка до цели: порция кандидатов набирается из кучи по оценке размера, после
+/// удаления место перемеряется. Куча строится за O(n) и разбирается только на
+/// нужную часть, полной сортировки миллионов файлов нет.
+void Cleaner::runQuota(Deleter &deleter, const std::vector<bool> &selected) {
+    PROFILE_SCOPE("Cleaner::runQuota");
+    std::map<std::uint64_t, QuotaFs> filesystems;
+    std::vector<QuotaCandidate> heap;
+    std::int64_t now = fileTimeNow();
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+        if (!selected.empty() && !selected[i]) continue;
+        auto priority = config.groupPriority.find(targets[i].name);
+        double weight = priority != config.groupPriority.end() ? priority->second : 1.0;
+        for (size_t j = 0; j < snapshot[i].paths.size(); ++j) {
+            const PathScan &pathScan = snapshot[i].paths[j];
+            if (!pathScan.exists || pathScan.protectedPath || !pathScan.error.empty()) continue;
+            DiskSpace space;
+            std::error_code ec;
+            if (!diskSpace(pathScan.path, space, ec)) {
+                LOG_WARNING("Не удалось получить место на диске для " + pathScan.path + ": " + ec.message());
                 continue;
             }
-            std::string name = p.filename().string();
-            if (!config.includeHidden && !name.empty() && name.front() == '.')
-                continue;
+            QuotaFs &fsInfo = filesystems[space.id];
+            if (fsInfo.path.empty()) {
+                fsInfo.path = pathScan.path;
+                fsInfo.start = space;
+                fsInfo.current = space;
+            }
+            for (size_t k = 0; k < pathScan.entries.size(); ++k) {
+                const ScanEntry &entry = pathScan.entries[k];
+                if (entry.directory) continue;
+                double age = static_cast<double>(std::max<std::int64_t>(now - entry.accessed, 0));
+                heap.push_back({age * weight, static_cast<std::uint32_t>(i),
+                                static_cast<std::uint32_t>(j), k, space.id});
+            }
+        }
+    }
+    std::make_heap(heap.begin(), heap.end());
+
+    // Сколько ещё освободить: всего (--free-target) и на каждой ФС (--free-until)
+    auto totalNeed = [&]() -> std::uintmax_t {
+        if (config.freeTarget == 0) return 0;
+        std::uintmax_t freed = 0;
+        for (const auto &item : filesystems) {
+            if (item.second.current.available > item.second.start.available) {
+                freed += item.second.current.available - item.second.start.available;
+            }
+        }
+        return freed < config.freeTarget ? config.freeTarget - freed : 0;
+    };
+    auto fsNeed = [&](const QuotaFs &fsInfo) -> std::uintmax_t {
+        if (config.freeUntil <= 0) return 0;
+        // Заполненность как в df: занято / (занято + доступно), резерв root не в счёт
+        const DiskSpace &space = fsInfo.current;
+        std::uintmax_t used = space.capacity - std::min(space.free, space.capacity);
+        auto limit = static_cast<std::uintmax_t>(static_cast<double>(used + space.available) * config.freeUntil / 100);
+        return used > limit ? used - limit : 0;
+    };
+    auto logNeed = [&](const char *prefix) {
+        if (config.freeTarget > 0) LOG_INFO(std::string(prefix) + "осталось освободить " + formatSize(totalNeed()));
+        for (const auto &item : filesystems) {
+            if (config.freeUntil <= 0) break;
+            LOG_INFO(std::string(prefix) + item.second.path + ": до заполненности " +
+                     std::to_string(static_cast<int>(config.freeUntil)) + "% осталось освободить " +
+                     formatSize(fsNeed(item.second)));
+        }
+    };
+    logNeed("Очистка до цели: ");
 
-            entries.push_back(p);
+    std::vector<QuotaCandidate> deferred;   // Кандидаты с ФС, где цель уже достигнута
+    for (unsigned round = 1; !heap.empty(); ++round) {
+        // Порция по оценке размера: видимый размер, на диске может освободиться меньше
+        std::uintmax_t total = totalNeed();
+        std::map<std::uint64_t, std::uintmax_t> need;
+        size_t unsatisfied = 0;
+        for (const auto &item : filesystems) {
+            need[item.first] = fsNeed(item.second);
+            if (need[item.first] > 0) unsatisfied++;
         }
+        if (total == 0 && unsatisfied == 0) break;
 
-        for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
-            std::string entryPath = it->string();
-            if (config.dryRun) {
-                LOG_INFO("[Dry Run] Будет удалено: " + entryPath);
-            } else {
-                deleteEntry(entryPath);
+        // Отобранные файлы — плоские снимки без корня: имя элемента и есть полный путь
+        std::vector<PathScan> selected(snapshot.size());
+        size_t count = 0;
+        while (!heap.empty() && (total > 0 || unsatisfied > 0)) {
+            std::pop_heap(heap.begin(), heap.end());
+            QuotaCandidate candidate = heap.back();
+            heap.pop_back();
+            std::uintmax_t &fsLeft = need[candidate.fs];
+            if (total == 0 && fsLeft == 0) {
+                deferred.push_back(candidate);
+                continue;
+            }
+            const PathScan &source = snapshot[candidate.group].paths[candidate.path];
+            PathScan &batch = selected[candidate.group];
+            ScanEntry entry = source.entries[candidate.entry];
+            entry.name = batch.names.store(entryPath(source, candidate.entry));
+            entry.parent = ScanEntry::noParent;
+            total -= std::min(total, entry.size);
+            if (fsLeft > 0) {
+                fsLeft -= std::min(fsLeft, entry.size);
+                if (fsLeft == 0) unsatisfied--;
             }
+            batch.entries.push_back(entry);
+            count++;
         }
-    } catch (const fs::filesystem_error &e) {
-        if (e.code() == std::make_error_code(std::errc::permission_denied) ||
-            std::string(e.what()).find("Permission denied") != std::string::npos) {
-            LOG_WARNING("Отказ в доступе к " + path + ". Пропускаем.");
-            addDeniedPath(path);
-        } else {
-            LOG_ERROR("Ошибка доступа к " + path + ": " + e.what());
+        if (count == 0) break;
+        LOG_DEBUG("Очистка до цели, порция " + std::to_string(round) + ": " + std::to_string(count) + " файлов");
+        for (size_t i = 0; i < selected.size(); ++i) deleter.add(selected[i], i);
+        deleter.wait();
+        if (config.dryRun) break;
+
+        // Проверка фактически освобождённого места
+        bool progress = false;
+        for (auto &item : filesystems) {
+            std::error_code ec;
+            DiskSpace space;
+            if (!diskSpace(item.second.path, space, ec)) continue;
+            progress = progress || space.available > item.second.current.available;
+            item.second.current = space;
+        }
+        if (!progress) {
+            LOG_WARNING("Очистка до цели: место не освобождается (файлы открыты или имеют жёсткие ссылки)");
+            break;
         }
+        for (const auto &candidate : deferred) {
+            heap.push_back(candidate);
+            std::push_heap(heap.begin(), heap.end());
+        }
+        deferred.clear();
     }
-}
-
 
-/// Удаление файла или директории
-void Cleaner::deleteEntry(const std::string &path) {
-    std::error_code ec;
-    if (fs::is_directory(path))
-        fs::remove_all(path, ec);
-    else
-        fs::remove(path, ec);
+    if (config.dryRun) return;
+    bool reached = totalNeed() == 0;
+    for (const auto &item : filesystems) reached = reached && fsNeed(item.second) == 0;
+    if (reached) {
+        LOG_INFO("Очистка до цели: цель достигнута");
+    } else {
+        logNeed("Очистка до цели не завершена: ");
+    }
+}
 
+/// Учёт результата удаления одного элемента
+void Cleaner::reportDeletion(const ScanEntry &entry, const std::string &path, size_t group, bool removed,
+                             const std::error_code &ec) {
+    if (config.dryRun) {
+        LOG_INFO("[Dry Run] Будет удалено: " + path);
+        return;
+    }
     if (ec) {
+        // Директория не пуста: в ней остались скрытые или не удалённые элементы,
+        // об ошибках детей уже сообщено
+        if (entry.directory && (ec == std::make_error_code(std::errc::directory_not_empty) ||
+                                ec == std::make_error_code(std::errc::file_exists))) {
+            LOG_DEBUG("Оставлена непустая директория: " + path);
+            return;
+        }
         LOG_WARNING("Ошибка удаления " + path + ": " + ec.message());
-        addDeniedPath(path);
+        addDeniedPath(path, ec, group);
+        return;
+    }
+    if (!removed) {
+        LOG_DEBUG("Уже удалено: " + path);
+        return;
+    }
+    if (entry.directory) {
+        removedDirs++;
     } else {
-        LOG_INFO("Удалено: " + path);
+        removedFiles++;
+        freedBytes += entry.size;
+        PROFILE_COUNT(BytesFreed, entry.size);
     }
+    PROFILE_GROUP(group, entry.directory ? 0 : entry.size);
+    LOG_INFO("Удалено: " + path);
 }
 
 void Cleaner::printPlan() {
+    PROFILE_SCOPE("Cleaner::printPlan");
+    scan();
     LOG_INFO("План очистки:");
     struct Stat {
         size_t index;
@@ -498,69 +871,193 @@ void Cleaner::printPlan() {
     };
     std::vector<Stat> stats;
     stats.reserve(targets.size());
-    std::vector<std::vector<uintmax_t>> sizes;
-    sizes.resize(targets.size());
-    uintmax_t totalBytes = 0;
-    for (size_t i = 0; i < targets.size(); ++i) {
-        const auto &group = targets[i];
-        if (group.paths.empty()) continue;
-        uintmax_t groupBytes = 0;
-        sizes[i].reserve(group.paths.size());
-        for (const auto &path : group.paths) {
-            uintmax_t bytes = directorySize(path);
-            sizes[i].push_back(bytes);
-            groupBytes += bytes;
-        }
+    uintmax_t totalBytes = 0, totalDisk = 0, totalReclaimable = 0;
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+        uintmax_t groupBytes = snapshot[i].bytes;
         if (groupBytes == 0) continue;
         totalBytes += groupBytes;
+        totalDisk += snapshot[i].diskBytes;
+        totalReclaimable += snapshot[i].reclaimableBytes;
         stats.push_back({i, groupBytes});
     }
-    std::sort(stats.begin(), stats.end(),
+    // При учёте по inode рядом с видимым размером показываем занятое и освобождаемое место
+    auto diskUsage = [this](uintmax_t disk, uintmax_t reclaimable) {
+        if (!config.inodeAccounting) return std::string();
+        return " (на диске " + formatSize(disk) + ", освободится " + formatSize(reclaimable) + ")";
+    };
+    std::stable_sort(stats.begin(), stats.end(),
               [](const Stat &a, const Stat &b) { return a.bytes > b.bytes; });
 
     for (const auto &stat : stats) {
         const auto &group = targets[stat.index];
         size_t nonZeroCount = 0;
-        for (uintmax_t bytes : sizes[stat.index]) {
-            if (bytes > 0) nonZeroCount++;
+        const auto &pathScans = snapshot[stat.index].paths;
+        for (const auto &pathScan : pathScans) {
+            if (pathScan.bytes > 0) nonZeroCount++;
         }
-        std::string line = group.scope + " / " + group.name + " - " +
-            std::to_string(nonZeroCount) + " путей, " + formatSize(stat.bytes);
-        LOG_INFO(line);
+        LOG_INFO(concat({group.scope, " / ", group.name, " - ", std::to_string(nonZeroCount), " путей, ",
+                         formatSize(stat.bytes),
+                         diskUsage(snapshot[stat.index].diskBytes, snapshot[stat.index].reclaimableBytes)}));
         if (config.verbose) {
-            for (size_t i = 0; i < group.paths.size(); ++i) {
-                uintmax_t bytes = sizes[stat.index][i];
-                if (bytes == 0) continue;
-                LOG_INFO("    " + group.paths[i] + " - " + formatSize(bytes));
+            for (const auto &pathScan : pathScans) {
+                if (pathScan.bytes == 0) continue;
+                LOG_INFO("    " + pathScan.path + " - " + formatSize(pathScan.bytes) +
+                         diskUsage(pathScan.diskBytes, pathScan.reclaimableBytes));
             }
         }
     }
-    LOG_INFO("Итого: " + formatSize(totalBytes));
+    LOG_INFO("Итого: " + formatSize(totalBytes) + diskUsage(totalDisk, totalReclaimable));
+}
+
+void Cleaner::writeReport(Report &report) {
+    PROFILE_SCOPE("Cleaner::writeReport");
+    scan();
+    std::map<std::string, std::vector<size_t>> failed = deniedByTarget(deniedList());
+    for (size_t i = 0; i < targets.size(); ++i) {
+        const TargetGroup &group = targets[i];
+        GroupReport groupReport;
+        groupReport.scope = std::string(group.scope);
+        groupReport.name = std::string(group.name);
+        groupReport.pattern = std::string(group.pattern);
+        report.beginGroup(groupReport);
+        for (const auto &pathScan : snapshot[i].paths) {
+            PathReport pathReport;
+            pathReport.path = pathScan.path;
+            pathReport.exists = pathScan.exists;
+            pathReport.denied = pathScan.denied;
+            pathReport.files = pathScan.files;
+            pathReport.dirs = pathScan.dirs;
+            pathReport.bytes = pathScan.bytes;
+            pathReport.error = pathScan.error;
+            pathReport.errors = (pathScan.error.empty() ? 0 : 1);
+            auto failures = failed.find(pathScan.path);
+            if (!pathScan.denied && failures != failed.end()) pathReport.errors += failures->second.size();
+            report.addPath(groupReport, pathReport);
+
+            groupReport.files += pathReport.files;
+            groupReport.dirs += pathReport.dirs;
+            groupReport.bytes += pathReport.bytes;
+            groupReport.denied += pathReport.denied ? 1 : 0;
+            groupReport.errors += pathReport.errors;
+        }
+        report.endGroup(groupReport);
+    }
 }
 
-void Cleaner::addTargetGroup(const std::string &scope, const PathEntry &entry, bool windowsPath) {
+RunSummary Cleaner::summary() {
+    scan();
+    RunSummary result;
+    result.dryRun = config.dryRun;
+    for (const auto &groupScan : snapshot) {
+        result.bytes += groupScan.bytes;
+        for (const auto &pathScan : groupScan.paths) {
+            result.files += pathScan.files;
+            result.dirs += pathScan.dirs;
+        }
+    }
+    result.removedFiles = removedFiles;
+    result.removedDirs = removedDirs;
+    result.freedBytes = freedBytes;
+    std::lock_guard<std::mutex> lock(deniedMutex);
+    result.failed = deniedPaths.size();
+    return result;
+}
+
+void Cleaner::resetScan() {
+    snapshot.clear();
+    scanned = false;
+    snapshotEntries = false;
+}
+
+void Cleaner::addTargetGroup(std::string_view scope, const PathEntry &entry, bool windowsPath) {
     std::string p = entry.value;
     if (windowsPath && config.wsl) {
         p = transformPathForWSL(p);
     }
-    p = expandPath(p);
+    p = expandPath(p, env);
     if (p.empty() || p.find('%') != std::string::npos) return;
 
     TargetGroup group;
-    group.scope = scope;
-    group.name = entry.key;
-    group.pattern = p;
-    group.paths = resolvePattern(p);
+    group.scope = intern(scope);
+    group.name = intern(entry.key);
+    group.pattern = strings.store(p);
+    auto filter = config.groupFilters.find(entry.key);
+    if (filter != config.groupFilters.end()) {
+        if (filter->second.active()) group.filter = &filter->second;
+    } else if (config.defaultFilter.active()) {
+        group.filter = &config.defaultFilter;
+    }
     targets.push_back(std::move(group));
 }
 
-std::vector<std::string> Cleaner::resolvePattern(const std::string &path) const {
-    std::string norm = normalizeSeparators(path);
-    if (!hasWildcard(norm)) return {norm};
-    return expandGlob(norm);
+/// Разворачивание шаблонов всех групп одним проходом: директории, общие для
+/// нескольких шаблонов, читаются один раз
+void Cleaner::resolvePatterns() {
+    GlobSet globs;
+    std::vector<std::pair<size_t, size_t>> pending;    // Группа и номер её шаблона
+    for (size_t i = 0; i < targets.size(); ++i) {
+        std::string norm = normalizeSeparators(std::string(targets[i].pattern));
+        if (!GlobSet::isPattern(norm)) {
+            targets[i].paths = {norm == targets[i].pattern ? targets[i].pattern : strings.store(norm)};
+            continue;
+        }
+        pending.emplace_back(i, globs.add(norm));
+    }
+    if (pending.empty()) return;
+    std::vector<std::vector<std::string_view>> expanded = globs.expand(strings);
+    for (const auto &entry : pending) targets[entry.first].paths = std::move(expanded[entry.second]);
+}
+
+std::string_view Cleaner::intern(std::string_view text) {
+    auto it = interned.find(text);
+    if (it != interned.end()) return *it;
+    return *interned.insert(strings.store(text)).first;
+}
+
+void Cleaner::addDeniedPath(const std::string &path, const std::error_code &error, size_t group) {
+    std::lock_guard<std::mutex> lock(deniedMutex);
+    deniedPaths.emplace(path, DeniedPath{error, group});
 }
 
-void Cleaner::addDeniedPath(const std::string &path) {
-    if (std::find(deniedPaths.begin(), deniedPaths.end(), path) == deniedPaths.end())
-        deniedPaths.push_back(path);
+std::vector<std::pair<std::string, Cleaner::DeniedPath>> Cleaner::deniedList() {
+    std::vector<std::pair<std::string, DeniedPath>> denied;
+    {
+        std::lock_guard<std::mutex> lock(deniedMutex);
+        denied.assign(deniedPaths.begin(), deniedPaths.end());
+    }
+    std::sort(denied.begin(), denied.end(),
+              [](const auto &a, const auto &b) { return a.first < b.first; });
+    return denied;
+}
+
+/// Цель ищется подъёмом по родителям пути до одного из путей его группы: O(глубины)
+/// на путь вместо сравнения со всеми путями целей
+std::map<std::string, std::vector<size_t>> Cleaner::deniedByTarget(
+    const std::vector<std::pair<std::string, DeniedPath>> &denied) const {
+    std::vector<std::unordered_set<std::string_view>> roots(targets.size());
+    std::map<std::string, std::vector<size_t>> result;
+    for (size_t i = 0; i < denied.size(); ++i) {
+        const std::string &path = denied[i].first;
+        size_t group = denied[i].second.group;
+        std::string_view root(path);
+        if (group < targets.size()) {
+            auto &paths = roots[group];
+            if (paths.empty()) paths.insert(targets[group].paths.begin(), targets[group].paths.end());
+            std::string_view parent(path);
+            while (!paths.count(parent)) {
+                size_t slash = parent.find_last_of("/\\");
+                if (slash == std::string_view::npos) break;
+                // Путь цели может оканчиваться разделителем (в том числе "/")
+                if (paths.count(parent.substr(0, slash + 1))) {
+                    parent = parent.substr(0, slash + 1);
+                    break;
+                }
+                if (slash == 0) break;
+                parent = parent.substr(0, slash);
+            }
+            if (paths.count(parent)) root = parent;
+        }
+        result[std::string(root)].push_back(i);
+    }
+    return result;
 }
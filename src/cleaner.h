@@ -2,47 +2,147 @@
 #define CLEANER_H
 
 #include "config.h"
+#include "deleter.h"
+#include "patharena.h"
+#include "report.h"
+#include "scanner.h"
+#include "utils.h"
+#include <atomic>
+#include <map>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <tuple>
+#include <unordered_map>
+#include <unordered_set>
 
 /// Класс, реализующий логику очистки
 class Cleaner {
 public:
-    explicit Cleaner(const Config &config);
+    /// env — окружение для разворачивания путей целей (по умолчанию окружение процесса)
+    explicit Cleaner(const Config &config, const EnvContext &env = environment());
     
-    /// Запуск процесса очистки
-    void run();
+    /// Запуск процесса очистки. selected — какие группы очищать (пусто — все)
+    void run(const std::vector<bool> &selected = {});
 
     /// Подсчет количества файлов, папок и общего размера перед удалением
     std::tuple<size_t, size_t, double> countItemsToDelete();
 
     void printPlan();
+
+    /// Запись итогов по группам и путям в машиночитаемый отчёт
+    void writeReport(Report &report);
+
+    /// Итоги запуска: план и фактически удалённое
+    RunSummary summary();
+
+    /// Сбросить снимок: следующий план или запуск сканирует цели заново
+    void resetScan();
+
+    /// Группа целей. Строки — представления в хранилище Cleaner (живут, пока жив он):
+    /// область и имя общие для всех групп, пути шаблона лежат подряд в блоках хранилища
+    struct TargetGroup {
+        std::string_view scope;
+        std::string_view name;
+        std::string_view pattern;
+        std::vector<std::string_view> paths;
+        const RetentionFilter *filter = nullptr;   // Условия удаления ([Filters]), nullptr — всё
+    };
+
+    /// Группы целей с развёрнутыми путями и пути, исключённые из обхода родительских целей
+    const std::vector<TargetGroup> &groups() const { return targets; }
+    const std::unordered_set<std::string> &excluded() const { return excludedPaths; }
     
 private:
-    struct TargetGroup {
-        std::string scope;
-        std::string name;
-        std::string pattern;
-        std::vector<std::string> paths;
+
+    /// Снимок сканирования группы: по одному PathScan на каждый путь группы
+    struct GroupScan {
+        std::vector<PathScan> paths;
+        std::uintmax_t bytes = 0;
+        std::uintmax_t diskBytes = 0;
+        std::uintmax_t reclaimableBytes = 0;
     };
 
     Config config;
+    const EnvContext &env;
     std::vector<TargetGroup> targets;
-    std::vector<std::string> deniedPaths;
+    PathArena strings;                              // Строки групп целей (см. TargetGroup)
+    std::unordered_set<std::string_view> interned;  // Области и имена групп без повторов
+    std::unordered_set<std::string> excludedPaths;   // Вложенные цели внутри других целей
+    std::vector<GroupScan> snapshot;
+    bool scanned = false;
+    bool snapshotEntries = false;   // Снимок содержит элементы (иначе — только итоги)
+    /// Неудавшееся удаление: ошибка и группа цели, где оно случилось
+    struct DeniedPath {
+        std::error_code error;
+        size_t group = 0;
+    };
+    std::unordered_map<std::string, DeniedPath> deniedPaths;    // По пути: повторная ошибка не дублируется
+    std::mutex deniedMutex;
+    std::atomic<std::uint64_t> removedFiles{0};
+    std::atomic<std::uint64_t> removedDirs{0};
+    std::atomic<std::uint64_t> freedBytes{0};
     
     /// Формирование списка путей для очистки на основе конфигурации
     void buildTargetPaths();
+
+    /// Устранение пересечений целей: каждый физический путь принадлежит ровно одной
+    /// группе (побеждает самый точный путь), вложенные цели исключаются из обхода родителя
+    void resolveOverlaps();
+
+    /// Однократное сканирование всех целей (результат общий для плана, подсчёта и удаления).
+    /// Элементы собираются сразу, если за планом последует удаление по снимку; иначе
+    /// план строится по итогам из кэша.
+    void scan();
+
+    /// Используется ли кэш сканирования между запусками
+    bool cacheEnabled() const;
+
+    /// Нужны ли удалению элементы снимка: тогда кэш итогов не используется
+    bool entriesNeeded() const;
     
-    /// Рекурсивная обработка одного пути
-    void processPath(const std::string &path);
+    /// Обработка одного пути по данным снимка: dry-run или постановка в очередь удаления
+    /// с номером группы group
+    void processPath(const PathScan &scan, Deleter &deleter, size_t group);
     
-    /// Удаление файла или директории (с учётом dry-run)
-    void deleteEntry(const std::string &path);
+    /// Переносится ли путь группы в корзину (--trash): такие цели уходят целиком,
+    /// поэтому обходятся и удаляются вместе со скрытыми элементами
+    bool trashTarget(std::string_view path, size_t group) const;
+
+    /// Включена ли очистка до цели (--free-target / --free-until)
+    bool quotaMode() const;
+
+    /// Удаляются ли цели без фильтров потоковым обходом (режим streaming или --max-memory)
+    bool streamingDelete() const;
+
+    /// Очистка до цели: файлы всех групп по давности доступа (с весом группы из
+    /// [Priority]) удаляются порциями, пока statvfs не покажет, что цель достигнута
+    void runQuota(Deleter &deleter, const std::vector<bool> &selected);
+
+    /// Учёт результата удаления одного элемента (вызывается из рабочих потоков)
+    void reportDeletion(const ScanEntry &entry, const std::string &path, size_t group, bool removed,
+                        const std::error_code &ec);
+
+    void addTargetGroup(std::string_view scope, const PathEntry &entry, bool windowsPath);
+
+    /// Одна копия строки в хранилище на все группы (области, имена)
+    std::string_view intern(std::string_view text);
+
+    /// Разворачивание шаблонов путей всех групп (см. GlobSet)
+    void resolvePatterns();
+
+    void addDeniedPath(const std::string &path, const std::error_code &error, size_t group);
+
+    /// Неудавшиеся удаления, отсортированные по пути
+    std::vector<std::pair<std::string, DeniedPath>> deniedList();
+
+    /// Номера неудавшихся удалений по путям целей верхнего уровня (путь цели из группы)
+    std::map<std::string, std::vector<size_t>> deniedByTarget(
+        const std::vector<std::pair<std::string, DeniedPath>> &denied) const;
 
-    void addTargetGroup(const std::string &scope, const PathEntry &entry, bool windowsPath);
-    std::vector<std::string> resolvePattern(const std::string &path) const;
-    void addDeniedPath(const std::string &path);
+    /// Итоги неудавшихся удалений по причинам и целям, повтор отказов в правах через sudo
+    void reportDenied();
 };
 
 #endif // CLEANER_H
@@ -4,6 +4,7 @@
 #include <fstream>
 #include <algorithm>
 #include <cctype>
+#include <stdexcept>
 
 /// Вспомогательная функция для обрезки пробелов
 static std::string trim(const std::string& s) {
@@ -53,6 +54,113 @@ static std::string stripComment(const std::string &line) {
     return line.substr(0, cut);
 }
 
+static unsigned parseUnsigned(const std::string &value) {
+    try {
+        long long v = std::stoll(value);
+        return v > 0 ? static_cast<unsigned>(v) : 0;
+    } catch (const std::exception &) {
+        return 0;
+    }
+}
+
+/// Длительность в секундах: 30s, 15m, 12h, 7d, 2w; число без суффикса — дни
+static std::int64_t parseDuration(const std::string &value) {
+    try {
+        size_t used = 0;
+        double v = std::stod(value, &used);
+        std::string unit = toLower(trim(value.substr(used)));
+        double scale = 86400;
+        if (unit == "s") scale = 1;
+        else if (unit == "m") scale = 60;
+        else if (unit == "h") scale = 3600;
+        else if (unit == "w") scale = 7 * 86400;
+        return v > 0 ? static_cast<std::int64_t>(v * scale) : 0;
+    } catch (const std::exception &) {
+        return 0;
+    }
+}
+
+/// Размер в байтах: 512, 100K, 20M, 1.5G, 2T; isBytes — был ли суффикс единиц
+static std::uintmax_t parseSize(const std::string &value, bool *isBytes = nullptr) {
+    try {
+        size_t used = 0;
+        double v = std::stod(value, &used);
+        std::string unit = toLower(trim(value.substr(used)));
+        if (!unit.empty() && unit.back() == 'b') unit.pop_back();
+        if (!unit.empty() && unit.back() == 'i') unit.pop_back();
+        double scale = 1;
+        if (unit == "k") scale = 1024.0;
+        else if (unit == "m") scale = 1024.0 * 1024;
+        else if (unit == "g") scale = 1024.0 * 1024 * 1024;
+        else if (unit == "t") scale = 1024.0 * 1024 * 1024 * 1024;
+        if (isBytes) *isBytes = !unit.empty() || toLower(value).find('b') != std::string::npos;
+        return v > 0 ? static_cast<std::uintmax_t>(v * scale) : 0;
+    } catch (const std::exception &) {
+        return 0;
+    }
+}
+
+/// Скорость в байтах в секунду: 50M, 50M/s, 1G/s
+static std::uintmax_t parseRate(const std::string &value) {
+    std::string v = trim(value);
+    if (v.size() > 2 && toLower(v.substr(v.size() - 2)) == "/s") v.resize(v.size() - 2);
+    return parseSize(v);
+}
+
+/// Значение nice: от -20 до 19
+static int parseNice(const std::string &value) {
+    try {
+        return std::clamp(std::stoi(value), -20, 19);
+    } catch (const std::exception &) {
+        return 0;
+    }
+}
+
+/// Заполненность в процентах: 80, 80%; вне (0, 100) — выключено
+static double parsePercent(const std::string &value) {
+    try {
+        double v = std::stod(value);
+        return v > 0 && v < 100 ? v : 0;
+    } catch (const std::exception &) {
+        return 0;
+    }
+}
+
+/// Список расширений: без ведущей точки, в нижнем регистре
+static std::vector<std::string> parseExtensions(const std::vector<std::string> &values) {
+    std::vector<std::string> result;
+    for (auto ext : values) {
+        while (!ext.empty() && ext.front() == '.') ext.erase(ext.begin());
+        if (!ext.empty()) result.push_back(toLower(ext));
+    }
+    return result;
+}
+
+/// Одна настройка фильтра; false — неизвестный ключ
+static bool applyFilterOption(RetentionFilter &filter, const std::string &key, const std::string &value,
+                              const std::vector<std::string> &values) {
+    if (key == "min_age") {
+        filter.minAge = parseDuration(value);
+    } else if (key == "max_atime") {
+        filter.maxAtime = parseDuration(value);
+    } else if (key == "min_size") {
+        filter.minSize = parseSize(value);
+    } else if (key == "keep_newest") {
+        // Число — файлы, с единицами (K, M, G) — объём
+        bool isBytes = false;
+        std::uintmax_t amount = parseSize(value, &isBytes);
+        filter.keepNewest = isBytes ? 0 : amount;
+        filter.keepNewestBytes = isBytes ? amount : 0;
+    } else if (key == "include_ext") {
+        filter.includeExt = parseExtensions(values);
+    } else if (key == "exclude_ext") {
+        filter.excludeExt = parseExtensions(values);
+    } else {
+        return false;
+    }
+    return true;
+}
+
 static OS_TYPE parseOsValue(const std::string &value) {
     std::string v = toLower(value);
     if (v == "win" || v == "windows") return OS_TYPE::WINDOWS;
@@ -61,6 +169,26 @@ static OS_TYPE parseOsValue(const std::string &value) {
     return OS_TYPE::AUTO;
 }
 
+static DELETE_MODE parseDeleteMode(const std::string &value) {
+    std::string v = toLower(value);
+    if (v == "streaming" || v == "stream") return DELETE_MODE::STREAMING;
+    return DELETE_MODE::SNAPSHOT;
+}
+
+static IO_BACKEND parseIoBackend(const std::string &value) {
+    std::string v = toLower(value);
+    if (v == "uring" || v == "io_uring") return IO_BACKEND::URING;
+    if (v == "std") return IO_BACKEND::STD;
+    return IO_BACKEND::THREADS;
+}
+
+static REPORT_FORMAT parseReportFormat(const std::string &value) {
+    std::string v = toLower(value);
+    if (v == "json") return REPORT_FORMAT::JSON;
+    if (v == "ndjson" || v == "jsonl") return REPORT_FORMAT::NDJSON;
+    return REPORT_FORMAT::NONE;
+}
+
 /// Парсинг аргументов командной строки
 Config parseArguments(int argc, char* argv[]) {
     Config config;
@@ -73,10 +201,21 @@ Config parseArguments(int argc, char* argv[]) {
             config.verbose = true;
         } else if (arg == "--dry-run") {
             config.dryRun = true;
+        } else if (arg == "--plan") {
+            config.planOnly = true;
         } else if (arg == "--clean-windows") {
             config.cleanWindows = true;
         } else if (arg == "--include-hidden") {
             config.includeHidden = true;
+        } else if (arg == "--inode-accounting") {
+            config.inodeAccounting = true;
+        } else if (arg == "--profile") {
+            config.profile = true;
+        } else if (arg == "--no-cache") {
+            config.useCache = false;
+            config.useCacheSet = true;
+        } else if (arg == "--rebuild-cache") {
+            config.rebuildCache = true;
         } else if (arg == "--wsl") {
             config.wsl = true;
             config.wslSet = true;
@@ -95,6 +234,112 @@ Config parseArguments(int argc, char* argv[]) {
         } else if (arg == "--docker-prune-volumes") {
             config.dockerPrune = true;
             config.dockerPruneVolumes = true;
+        } else if (arg == "--cli-jobs") {
+            if (i + 1 < argc) {
+                config.cliJobs = parseUnsigned(argv[++i]);
+                config.cliJobsSet = true;
+            }
+        } else if (arg == "--cli-timeout") {
+            if (i + 1 < argc) {
+                config.cliTimeout = parseDuration(argv[++i]);
+                config.cliTimeoutSet = true;
+            }
+        } else if (arg == "--jobs" || arg == "-j") {
+            if (i + 1 < argc) {
+                config.jobs = parseUnsigned(argv[++i]);
+                config.jobsSet = true;
+            }
+        } else if (arg == "--max-inflight") {
+            if (i + 1 < argc) {
+                config.maxInFlight = parseUnsigned(argv[++i]);
+                config.maxInFlightSet = true;
+            }
+        } else if (arg == "--max-unlink-rate") {
+            if (i + 1 < argc) {
+                config.maxUnlinkRate = parseUnsigned(argv[++i]);
+                config.maxUnlinkRateSet = true;
+            }
+        } else if (arg == "--max-free-rate") {
+            if (i + 1 < argc) {
+                config.maxFreeRate = parseRate(argv[++i]);
+                config.maxFreeRateSet = true;
+            }
+        } else if (arg == "--nice") {
+            if (i + 1 < argc) {
+                config.niceLevel = parseNice(argv[++i]);
+                config.niceLevelSet = true;
+            }
+        } else if (arg == "--idle-io") {
+            config.idleIo = true;
+            config.idleIoSet = true;
+        } else if (arg == "--max-memory") {
+            if (i + 1 < argc) {
+                config.maxMemory = parseSize(argv[++i]);
+                config.maxMemorySet = true;
+            }
+        } else if (arg.rfind("--free-target=", 0) == 0) {
+            config.freeTarget = parseSize(arg.substr(14));
+            config.freeTargetSet = true;
+        } else if (arg == "--free-target") {
+            if (i + 1 < argc) {
+                config.freeTarget = parseSize(argv[++i]);
+                config.freeTargetSet = true;
+            }
+        } else if (arg.rfind("--free-until=", 0) == 0) {
+            config.freeUntil = parsePercent(arg.substr(13));
+            config.freeUntilSet = true;
+        } else if (arg == "--free-until") {
+            if (i + 1 < argc) {
+                config.freeUntil = parsePercent(argv[++i]);
+                config.freeUntilSet = true;
+            }
+        } else if (arg == "--daemon") {
+            config.daemon = true;
+        } else if (arg.rfind("--status-file=", 0) == 0) {
+            config.statusFile = arg.substr(14);
+            config.statusFileSet = true;
+        } else if (arg == "--status-file") {
+            if (i + 1 < argc) {
+                config.statusFile = argv[++i];
+                config.statusFileSet = true;
+            }
+        } else if (arg == "--trash") {
+            config.trash = true;
+            config.trashSet = true;
+        } else if (arg == "--purge-trash") {
+            config.purgeTrash = true;
+        } else if (arg == "--streaming-delete") {
+            config.deleteMode = DELETE_MODE::STREAMING;
+            config.deleteModeSet = true;
+        } else if (arg == "--delete-mode") {
+            if (i + 1 < argc) {
+                config.deleteMode = parseDeleteMode(argv[++i]);
+                config.deleteModeSet = true;
+            }
+        } else if (arg.rfind("--io-backend=", 0) == 0) {
+            config.ioBackend = parseIoBackend(arg.substr(13));
+            config.ioBackendSet = true;
+        } else if (arg == "--io-backend") {
+            if (i + 1 < argc) {
+                config.ioBackend = parseIoBackend(argv[++i]);
+                config.ioBackendSet = true;
+            }
+        } else if (arg.rfind("--report=", 0) == 0) {
+            config.reportFormat = parseReportFormat(arg.substr(9));
+            config.reportFormatSet = true;
+        } else if (arg == "--report") {
+            if (i + 1 < argc) {
+                config.reportFormat = parseReportFormat(argv[++i]);
+                config.reportFormatSet = true;
+            }
+        } else if (arg.rfind("--report-file=", 0) == 0) {
+            config.reportFile = arg.substr(14);
+            config.reportFileSet = true;
+        } else if (arg == "--report-file") {
+            if (i + 1 < argc) {
+                config.reportFile = argv[++i];
+                config.reportFileSet = true;
+            }
         } else if (arg == "--os") {
             if (i + 1 < argc) {
                 std::string osArg = argv[++i];
@@ -153,8 +398,58 @@ bool loadConfigFromFile(const std::string &filePath, Config &config) {
                 config.cleanWindows = parseBool(value);
             else if (key == "include_hidden")
                 config.includeHidden = parseBool(value);
+            else if (key == "inode_accounting")
+                config.inodeAccounting = parseBool(value);
+            else if (key == "profile")
+                config.profile = parseBool(value);
+            else if (key == "scan_cache") {
+                if (!config.useCacheSet) config.useCache = parseBool(value);
+            } else if (key == "cache_file")
+                config.cacheFile = expandPath(value);
+            else if (key == "report") {
+                if (!config.reportFormatSet) config.reportFormat = parseReportFormat(value);
+            } else if (key == "report_file") {
+                if (!config.reportFileSet) config.reportFile = expandPath(value);
+            }
             else if (key == "os")
                 config.targetOS = parseOsValue(value);
+            else if (key == "jobs") {
+                if (!config.jobsSet) config.jobs = parseUnsigned(value);
+            } else if (key == "max_inflight") {
+                if (!config.maxInFlightSet) config.maxInFlight = parseUnsigned(value);
+            } else if (key == "max_unlink_rate") {
+                if (!config.maxUnlinkRateSet) config.maxUnlinkRate = parseUnsigned(value);
+            } else if (key == "max_free_rate") {
+                if (!config.maxFreeRateSet) config.maxFreeRate = parseRate(value);
+            } else if (key == "nice") {
+                if (!config.niceLevelSet) config.niceLevel = parseNice(value);
+            } else if (key == "idle_io") {
+                if (!config.idleIoSet) config.idleIo = parseBool(value);
+            } else if (key == "delete_mode") {
+                if (!config.deleteModeSet) config.deleteMode = parseDeleteMode(value);
+            } else if (key == "max_memory") {
+                if (!config.maxMemorySet) config.maxMemory = parseSize(value);
+            } else if (key == "io_backend") {
+                if (!config.ioBackendSet) config.ioBackend = parseIoBackend(value);
+            } else if (key == "free_target") {
+                if (!config.freeTargetSet) config.freeTarget = parseSize(value);
+            } else if (key == "free_until") {
+                if (!config.freeUntilSet) config.freeUntil = parsePercent(value);
+            } else if (key == "cli_jobs") {
+                if (!config.cliJobsSet) config.cliJobs = parseUnsigned(value);
+            } else if (key == "cli_timeout") {
+                if (!config.cliTimeoutSet) config.cliTimeout = parseDuration(value);
+            } else if (key == "daemon_threshold") {
+                config.daemonThreshold = parseSize(value);
+            } else if (key == "daemon_cooldown") {
+                config.daemonCooldown = parseDuration(value);
+            } else if (key == "status_file") {
+                if (!config.statusFileSet) config.statusFile = expandPath(value);
+            } else if (key == "trash") {
+                if (!config.trashSet) config.trash = parseBool(value);
+            } else if (key == "trash_recreate") {
+                config.trashRecreate = parseBool(value);
+            }
             else if (key == "allow_sudo")
                 config.allowSudo = parseBool(value);
             else if (key == "cli_clean")
@@ -180,6 +475,27 @@ bool loadConfigFromFile(const std::string &filePath, Config &config) {
             for (const auto &v : values) {
                 if (!v.empty()) config.commonPaths.push_back({key, v});
             }
+        } else if (currentSection == "Thresholds") {
+            std::uintmax_t threshold = parseSize(value);
+            if (threshold > 0) config.groupThresholds[key] = threshold;
+        } else if (currentSection == "Priority") {
+            // Вес группы: во сколько раз её файлы «старее» при выборе кандидатов
+            try {
+                double weight = std::stod(value);
+                if (weight > 0) config.groupPriority[key] = weight;
+            } catch (const std::exception &) {
+                LOG_WARNING("Некорректный приоритет группы: " + key);
+            }
+        } else if (currentSection == "Filters") {
+            // Ключ "группа.настройка" — для группы с этим ключом, просто "настройка" — для всех
+            size_t dot = key.rfind('.');
+            RetentionFilter &filter = dot == std::string::npos
+                ? config.defaultFilter
+                : config.groupFilters[key.substr(0, dot)];
+            std::string option = dot == std::string::npos ? key : key.substr(dot + 1);
+            if (!applyFilterOption(filter, option, value, values)) {
+                LOG_WARNING("Неизвестная настройка фильтра: " + key);
+            }
         } else if (currentSection == "Paths") {
             for (const auto &v : values) {
                 if (!v.empty()) config.additionalPaths.push_back(v);
@@ -1,6 +1,8 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+#include <cstdint>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -12,17 +14,64 @@ enum class OS_TYPE {
     BOTH
 };
 
+// Режим удаления
+enum class DELETE_MODE {
+    SNAPSHOT,   // Удаление по снимку сканирования (один обход на весь запуск)
+    STREAMING   // Потоковый обход с удалением, память пропорциональна глубине дерева
+};
+
+// Реализация файловых операций
+enum class IO_BACKEND {
+    THREADS,    // Пул потоков + дескрипторы директорий (по умолчанию)
+    URING,      // Пакетные statx/unlinkat через io_uring
+    STD         // Переносимая реализация на std::filesystem
+};
+
+// Формат машиночитаемого отчёта
+enum class REPORT_FORMAT {
+    NONE,
+    JSON,       // Один JSON-объект на запуск
+    NDJSON      // Запись на строку: фазы, пути, группы, итог
+};
+
 struct PathEntry {
     std::string key;
     std::string value;
 };
 
+/// Условия удаления файлов цели (секция [Filters]); не прошедшие их файлы остаются
+struct RetentionFilter {
+    std::int64_t minAge = 0;            // Удалять файлы, не изменявшиеся столько секунд
+    std::int64_t maxAtime = 0;          // Удалять файлы, к которым не обращались столько секунд
+    std::uintmax_t minSize = 0;         // Удалять файлы не меньше этого размера
+    std::uint64_t keepNewest = 0;       // Оставить столько самых новых файлов
+    std::uintmax_t keepNewestBytes = 0; // Оставить самые новые файлы общим размером до
+    std::vector<std::string> includeExt;  // Удалять только эти расширения (без точки, в нижнем регистре)
+    std::vector<std::string> excludeExt;  // Никогда не удалять эти расширения
+
+    bool active() const {
+        return minAge > 0 || maxAtime > 0 || minSize > 0 || keepNewest > 0 || keepNewestBytes > 0 ||
+               !includeExt.empty() || !excludeExt.empty();
+    }
+};
+
 // Структура конфигурации для утилиты
 struct Config {
     bool verbose = false;           // Подробный вывод
     bool dryRun = false;            // Режим симуляции (ничего не удаляется, только лог)
+    bool planOnly = false;          // --plan: только план и итоги, без подтверждения и удаления
     bool cleanWindows = false;      // Флаг принудительной очистки Windows-директорий (в WSL)
     bool includeHidden = false;     // Обрабатывать скрытые файлы/папки
+    bool inodeAccounting = false;   // Учитывать жёсткие ссылки: каждый inode один раз
+    bool useCache = true;           // Кэш сканирования между запусками
+    bool useCacheSet = false;
+    bool rebuildCache = false;      // Не читать старый кэш, пересобрать с нуля
+    std::string cacheFile;          // Файл кэша (пусто — ~/.cache/kleyner/scan.cache)
+    REPORT_FORMAT reportFormat = REPORT_FORMAT::NONE;
+    bool reportFormatSet = false;
+    std::string reportFile = "-";   // Куда писать отчёт ("-" — стандартный вывод)
+    bool reportFileSet = false;
+    bool profile = false;           // Таблица счётчиков и таймеров (сборка с CLEANER_ENABLE_PROFILING)
     bool wsl = false;               // Флаг WSL (если true, меняем пути на /mnt/c/... и т.д.)
     bool wslSet = false;
     bool allowSudo = false;
@@ -30,11 +79,57 @@ struct Config {
     bool dockerPrune = false;
     bool dockerPruneAll = false;
     bool dockerPruneVolumes = false;
+    unsigned cliJobs = 4;           // CLI-команд очистки одновременно
+    bool cliJobsSet = false;
+    std::int64_t cliTimeout = 600;  // Предел на одну CLI-команду, секунд (0 — без предела)
+    bool cliTimeoutSet = false;
+    unsigned jobs = 0;              // Число потоков обхода/удаления (0 — по числу ядер)
+    bool jobsSet = false;
+    unsigned maxInFlight = 0;       // Максимум одновременных операций удаления (0 — без ограничения)
+    bool maxInFlightSet = false;
+    // Фоновая работа на нагруженных машинах: ограничение скорости удаления и приоритеты
+    unsigned maxUnlinkRate = 0;     // unlink/rmdir в секунду (0 — без ограничения)
+    bool maxUnlinkRateSet = false;
+    std::uintmax_t maxFreeRate = 0; // Освобождаемых байт в секунду (0 — без ограничения)
+    bool maxFreeRateSet = false;
+    int niceLevel = 0;              // nice процесса (0 — не менять)
+    bool niceLevelSet = false;
+    bool idleIo = false;            // Класс ввода-вывода idle (ioprio_set, Linux)
+    bool idleIoSet = false;
+    DELETE_MODE deleteMode = DELETE_MODE::SNAPSHOT;
+    bool deleteModeSet = false;
+    // Предел памяти на снимок (0 — без предела): цели без фильтров удаляются потоково,
+    // деревья с фильтрами, не уместившиеся в предел, пропускаются с ошибкой
+    std::uintmax_t maxMemory = 0;
+    bool maxMemorySet = false;
+    IO_BACKEND ioBackend = IO_BACKEND::THREADS;
+    bool ioBackendSet = false;
+    // Очистка до цели: удаляются давно не использованные файлы, пока не освобождено
+    // freeTarget байт или заполненность ФС целей не опустится до freeUntil процентов
+    std::uintmax_t freeTarget = 0;  // 0 — выключено
+    bool freeTargetSet = false;
+    double freeUntil = 0;           // 0 — выключено
+    bool freeUntilSet = false;
+    // Режим наблюдения (--daemon): итоги групп по inotify, очистка при превышении порогов
+    bool daemon = false;
+    std::uintmax_t daemonThreshold = 0; // Порог суммы всех групп, байт (0 — нет)
+    std::int64_t daemonCooldown = 300;  // Минимум секунд между очистками
+    std::string statusFile;         // Файл состояния (пусто — $XDG_RUNTIME_DIR/kleyner/status.json)
+    bool statusFileSet = false;
+    // Корзина (--trash): цели переносятся rename() в корзину на той же ФС, удаляет фоновый процесс
+    bool trash = false;
+    bool trashSet = false;
+    bool trashRecreate = true;      // Создать перенесённую целиком директорию заново пустой
+    bool purgeTrash = false;        // --purge-trash: только удалить содержимое корзин и выйти
     OS_TYPE targetOS = OS_TYPE::AUTO; // Целевая ОС (AUTO, WINDOWS или LINUX)
     std::vector<PathEntry> windowsPaths;
     std::vector<PathEntry> linuxPaths;
     std::vector<PathEntry> commonPaths;
     std::vector<std::string> additionalPaths; // Дополнительные пути для очистки
+    RetentionFilter defaultFilter;            // Фильтр для всех групп ([Filters] без имени группы)
+    std::map<std::string, RetentionFilter> groupFilters; // Фильтры групп по ключу: заменяют общий
+    std::map<std::string, double, std::less<>> groupPriority;         // Вес группы при очистке до цели ([Priority])
+    std::map<std::string, std::uintmax_t, std::less<>> groupThresholds; // Пороги групп для --daemon ([Thresholds])
     std::string configFile = "configs/basic.cfg"; // Путь к конфигурационному файлу
 };
 
@@ -0,0 +1,490 @@
+#include "daemon.h"
+#include "fsops.h"
+#include "logger.h"
+#include "report.h"
+#include "scanner.h"
+#include "utils.h"
+
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#ifdef __linux__
+#include <cerrno>
+#include <csignal>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+std::string defaultStatusPath() {
+    const auto &vars = environment().vars;
+    auto runtime = vars.find("XDG_RUNTIME_DIR");
+    if (runtime != vars.end() && !runtime->second.empty()) {
+        return (fs::path(runtime->second) / "kleyner" / "status.json").string();
+    }
+    return (fs::path(serviceDirectory()) / "status.json").string();
+}
+
+#ifdef __linux__
+
+namespace {
+
+volatile std::sig_atomic_t g_stop = 0;
+
+void onStopSignal(int) {
+    g_stop = 1;
+}
+
+// При переполнении лимита наблюдений итоги неотслеживаемых директорий обновляются
+// только полным пересканированием
+const std::chrono::minutes kLimitRescan(10);
+
+/// Итоги собственных файлов директории (без поддиректорий)
+struct DirTotals {
+    std::uint64_t files = 0;
+    std::uintmax_t bytes = 0;
+};
+
+/// Наблюдаемая директория
+struct WatchedDir {
+    std::string path;
+    size_t group = 0;
+    DirTotals totals;
+};
+
+/// Итоги групп целей, поддерживаемые по событиям inotify. На каждую директорию —
+/// одно наблюдение и итог её собственных файлов; при событии перечитывается
+/// только эта директория.
+class TreeWatcher {
+public:
+    TreeWatcher(const Config &config, const Cleaner &cleaner) : config(config), cleaner(cleaner) {}
+
+    ~TreeWatcher() {
+        if (fd >= 0) ::close(fd);
+    }
+
+    bool open(std::error_code &ec) {
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0) {
+            ec = std::error_code(errno, std::generic_category());
+            return false;
+        }
+        return true;
+    }
+
+    int descriptor() const { return fd; }
+
+    /// Полное сканирование: все наблюдения снимаются и ставятся заново
+    void scanAll() {
+        for (const auto &dir : dirs) inotify_rm_watch(fd, dir.first);
+        dirs.clear();
+        byPath.clear();
+        groups.assign(cleaner.groups().size(), DirTotals());
+        overflow = false;
+        watchLimit = false;
+        for (size_t i = 0; i < cleaner.groups().size(); ++i) {
+            for (std::string_view view : cleaner.groups()[i].paths) {
+                std::string path(view);
+                FileInfo info;
+                std::error_code ec;
+                if (isProtectedPath(path) || !statPath(path, info, ec)) continue;
+                if (info.kind == EntryKind::Directory) {
+                    addTree(path, i, false);
+                } else {
+                    // Цель-файл: учитывается при полном сканировании, без наблюдения
+                    groups[i].files++;
+                    groups[i].bytes += info.size;
+                }
+            }
+        }
+    }
+
+    /// Прочитать накопившиеся события и обновить итоги; true — итоги изменились
+    bool drain() {
+        alignas(struct inotify_event) char buffer[64 * 1024];
+        std::unordered_set<int> dirty;
+        bool changed = false;
+        for (;;) {
+            ssize_t n = ::read(fd, buffer, sizeof(buffer));
+            if (n <= 0) break;
+            for (char *p = buffer; p < buffer + n;) {
+                const auto *event = reinterpret_cast<const struct inotify_event *>(p);
+                p += sizeof(struct inotify_event) + event->len;
+                if (event->mask & IN_Q_OVERFLOW) {
+                    overflow = true;
+                    continue;
+                }
+                if (event->mask & IN_IGNORED) {
+                    // Директория удалена (или наблюдение снято)
+                    changed = forget(event->wd) || changed;
+                    continue;
+                }
+                auto dir = dirs.find(event->wd);
+                if (dir == dirs.end() || event->len == 0) continue;
+                if (event->mask & IN_ISDIR) {
+                    size_t group = dir->second.group;
+                    std::string path = joinPath(dir->second.path, event->name);
+                    if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                        addTree(path, group, true);
+                    } else if (event->mask & IN_MOVED_FROM) {
+                        removeTree(path);
+                    }
+                    changed = true;
+                    continue;
+                }
+                dirty.insert(event->wd);
+            }
+        }
+        for (int wd : dirty) {
+            auto dir = dirs.find(wd);
+            if (dir == dirs.end()) continue;
+            DirTotals after = readDir(dir->second.path, nullptr);
+            apply(dir->second.group, dir->second.totals, after);
+            dir->second.totals = after;
+            changed = true;
+        }
+        return changed;
+    }
+
+    bool needsRescan() const { return overflow; }
+    bool limitReached() const { return watchLimit; }
+    size_t watchCount() const { return dirs.size(); }
+    const std::vector<DirTotals> &totals() const { return groups; }
+
+private:
+    const Config &config;
+    const Cleaner &cleaner;
+    int fd = -1;
+    std::unordered_map<int, WatchedDir> dirs;
+    std::map<std::string, int> byPath;      // Упорядочено: поддерево — непрерывный диапазон
+    std::vector<DirTotals> groups;
+    bool overflow = false;
+    bool watchLimit = false;
+
+    /// Наблюдение и учёт поддерева. checkRoot — корень появился по событию и может
+    /// оказаться путём другой цели
+    void addTree(const std::string &root, size_t group, bool checkRoot) {
+        const std::uint32_t mask = IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+        std::vector<std::string> stack{root};
+        while (!stack.empty()) {
+            std::string dir = std::move(stack.back());
+            stack.pop_back();
+            if (isProtectedPath(dir)) continue;
+            if ((checkRoot || dir != root) && isExcludedPath(dir, &cleaner.excluded())) continue;
+            // Символическая ссылка раскрывается только у корня цели, как при сканировании
+            bool follow = dir == root && !checkRoot;
+            int wd = inotify_add_watch(fd, dir.c_str(), follow ? mask : mask | IN_DONT_FOLLOW);
+            if (wd < 0 && errno != ENOSPC) continue;    // Директория уже исчезла или нет доступа
+            if (wd < 0 && !watchLimit) {
+                watchLimit = true;
+                LOG_WARNING("Достигнут предел inotify (fs.inotify.max_user_watches): часть директорий "
+                            "не отслеживается, их итоги обновляются полным пересканированием");
+            }
+            if (wd >= 0 && dirs.count(wd) > 0) continue;    // Уже учтена
+            std::vector<std::string> subdirs;
+            DirTotals totals = readDir(dir, &subdirs);
+            apply(group, DirTotals(), totals);
+            if (wd >= 0) {
+                dirs[wd] = {dir, group, totals};
+                byPath[dir] = wd;
+            }
+            for (auto &sub : subdirs) stack.push_back(std::move(sub));
+        }
+    }
+
+    /// Снять наблюдение с поддерева (перенесено за пределы цели)
+    void removeTree(const std::string &root) {
+        auto drop = [&](std::map<std::string, int>::iterator it) {
+            inotify_rm_watch(fd, it->second);
+            auto dir = dirs.find(it->second);
+            if (dir != dirs.end()) {
+                apply(dir->second.group, dir->second.totals, DirTotals());
+                dirs.erase(dir);
+            }
+            return byPath.erase(it);
+        };
+        auto exact = byPath.find(root);
+        if (exact != byPath.end()) drop(exact);
+        std::string prefix = root + "/";
+        for (auto it = byPath.lower_bound(prefix);
+             it != byPath.end() && it->first.compare(0, prefix.size(), prefix) == 0;) {
+            it = drop(it);
+        }
+    }
+
+    bool forget(int wd) {
+        auto dir = dirs.find(wd);
+        if (dir == dirs.end()) return false;
+        apply(dir->second.group, dir->second.totals, DirTotals());
+        auto path = byPath.find(dir->second.path);
+        if (path != byPath.end() && path->second == wd) byPath.erase(path);
+        dirs.erase(dir);
+        return true;
+    }
+
+    /// Собственные файлы директории; поддиректории — в subdirs. Учёт как у сканера:
+    /// скрытые файлы без --include-hidden не считаются, скрытые директории обходятся
+    DirTotals readDir(const std::string &dir, std::vector<std::string> *subdirs) {
+        DirTotals out;
+        std::error_code ec;
+        DirHandle handle = DirHandle::open(dir, ec);
+        if (ec) return out;
+        std::vector<StatOp> stats;
+        DirItem item;
+        while (handle.next(item, ec)) {
+            if (item.kind == EntryKind::Directory) {
+                if (subdirs) subdirs->push_back(joinPath(dir, item.name));
+                continue;
+            }
+            bool hidden = !config.includeHidden && isHiddenName(item.name);
+            if (item.kind == EntryKind::Unknown || (item.kind == EntryKind::File && !hidden)) {
+                stats.push_back({item.name, FileInfo(), std::error_code()});
+            } else if (!hidden) {
+                out.files++;
+            }
+        }
+        handle.statBatch(stats);
+        for (const auto &op : stats) {
+            if (op.ec) continue;
+            if (op.info.kind == EntryKind::Directory) {
+                if (subdirs) subdirs->push_back(joinPath(dir, op.name));
+                continue;
+            }
+            if (!config.includeHidden && isHiddenName(op.name)) continue;
+            out.files++;
+            out.bytes += op.info.size;
+        }
+        return out;
+    }
+
+    void apply(size_t group, const DirTotals &before, const DirTotals &after) {
+        groups[group].files = groups[group].files - before.files + after.files;
+        groups[group].bytes = groups[group].bytes - before.bytes + after.bytes;
+    }
+};
+
+/// Счётчики работы режима наблюдения для файла состояния
+struct DaemonState {
+    std::uint64_t started = 0;
+    std::uint64_t cleanups = 0;
+    std::uint64_t lastCleanup = 0;
+};
+
+std::uint64_t unixNow() {
+    return static_cast<std::uint64_t>(std::time(nullptr));
+}
+
+/// Путь без завершающего разделителя, как его строит обход
+std::string normalDir(const fs::path &path) {
+    fs::path normal = path.lexically_normal();
+    if (!normal.has_filename() && normal.has_relative_path()) normal = normal.parent_path();
+    return normal.string();
+}
+
+/// Лежит ли файл внутри наблюдаемой цели (а не в исключённой из неё вложенной):
+/// каждая запись в нём вызывала бы событие, пересчёт и новую запись, а очистка
+/// удаляла бы его
+bool insideTargets(const std::string &file, const Cleaner &cleaner) {
+    std::unordered_set<std::string> roots;
+    for (const auto &group : cleaner.groups()) {
+        for (std::string_view path : group.paths) roots.insert(normalDir(fs::path(path)));
+    }
+    fs::path dir = fs::path(normalDir(file)).parent_path();
+    for (;;) {
+        std::string text = dir.string();
+        if (cleaner.excluded().count(text) > 0) return false;
+        if (roots.count(text) > 0) return true;
+        if (!dir.has_relative_path()) return false;
+        dir = dir.parent_path();
+    }
+}
+
+/// Файл состояния пишется целиком во временный и переименовывается: читатель
+/// никогда не видит половину записи. Пустой путь — файл состояния отключён
+bool writeStatus(const std::string &path, const Config &config, const Cleaner &cleaner,
+                 const TreeWatcher &watcher, const DaemonState &state) {
+    if (path.empty()) return true;
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+    std::string temp = path + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::trunc);
+        if (!out) return false;
+        JsonWriter writer(out);
+        std::uint64_t totalFiles = 0;
+        std::uintmax_t totalBytes = 0;
+        for (const auto &group : watcher.totals()) {
+            totalFiles += group.files;
+            totalBytes += group.bytes;
+        }
+        writer.beginObject();
+        writer.field("pid", static_cast<std::uint64_t>(::getpid()));
+        writer.field("started", state.started);
+        writer.field("updated", unixNow());
+        writer.field("watches", static_cast<std::uint64_t>(watcher.watchCount()));
+        writer.field("watch_limit_reached", watcher.limitReached());
+        writer.field("cleanups", state.cleanups);
+        writer.field("last_cleanup", state.lastCleanup);
+        writer.field("threshold", static_cast<std::uint64_t>(config.daemonThreshold));
+        writer.field("files", totalFiles);
+        writer.field("bytes", static_cast<std::uint64_t>(totalBytes));
+        writer.key("groups");
+        writer.beginArray();
+        for (size_t i = 0; i < cleaner.groups().size(); ++i) {
+            const auto &group = cleaner.groups()[i];
+            auto threshold = config.groupThresholds.find(group.name);
+            writer.beginObject();
+            writer.field("scope", group.scope);
+            writer.field("name", group.name);
+            writer.field("files", watcher.totals()[i].files);
+            writer.field("bytes", static_cast<std::uint64_t>(watcher.totals()[i].bytes));
+            writer.field("threshold", static_cast<std::uint64_t>(
+                threshold != config.groupThresholds.end() ? threshold->second : 0));
+            writer.endObject();
+        }
+        writer.endArray();
+        writer.endObject();
+        out << '\n';
+        if (!out) {
+            fs::remove(temp, ec);
+            return false;
+        }
+    }
+    fs::rename(temp, path, ec);
+    if (ec) {
+        fs::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
+
+/// Группы, превысившие порог; превышение общего порога выбирает все группы
+std::vector<bool> crossedGroups(const Config &config, const Cleaner &cleaner, const TreeWatcher &watcher) {
+    const auto &totals = watcher.totals();
+    std::vector<bool> selected(totals.size(), false);
+    std::uintmax_t total = 0;
+    for (size_t i = 0; i < totals.size(); ++i) {
+        total += totals[i].bytes;
+        auto threshold = config.groupThresholds.find(cleaner.groups()[i].name);
+        if (threshold != config.groupThresholds.end() && totals[i].bytes > threshold->second) {
+            selected[i] = true;
+        }
+    }
+    if (config.daemonThreshold > 0 && total > config.daemonThreshold) selected.assign(totals.size(), true);
+    return selected;
+}
+
+} // namespace
+
+int runDaemon(const Config &config, Cleaner &cleaner) {
+    TreeWatcher watcher(config, cleaner);
+    std::error_code ec;
+    if (!watcher.open(ec)) {
+        LOG_ERROR("inotify недоступен: " + ec.message());
+        return 1;
+    }
+    struct sigaction action {};
+    action.sa_handler = onStopSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    std::string statusPath = config.statusFile.empty() ? defaultStatusPath() : config.statusFile;
+    if (insideTargets(statusPath, cleaner)) {
+        // Служебная директория исключена из всех целей
+        std::string fallback = (fs::path(serviceDirectory()) / "status.json").string();
+        if (insideTargets(fallback, cleaner)) fallback.clear();
+        LOG_WARNING("Файл состояния " + statusPath + " внутри наблюдаемой цели, " +
+                    (fallback.empty() ? std::string("состояние не записывается") : "используется " + fallback));
+        statusPath = fallback;
+    }
+    DaemonState state;
+    state.started = unixNow();
+    using Clock = std::chrono::steady_clock;
+    const auto cooldown = std::chrono::seconds(config.daemonCooldown);
+
+    watcher.scanAll();
+    auto lastRescan = Clock::now();
+    std::uintmax_t total = 0;
+    for (const auto &group : watcher.totals()) total += group.bytes;
+    LOG_INFO("Режим наблюдения: " + std::to_string(watcher.watchCount()) + " директорий, итого " +
+             formatSize(total) + "; состояние: " + statusPath);
+    if (config.daemonThreshold == 0 && config.groupThresholds.empty()) {
+        LOG_WARNING("Пороги не заданы (daemon_threshold, [Thresholds]): только учёт, без очистки");
+    }
+    if (!writeStatus(statusPath, config, cleaner, watcher, state)) {
+        LOG_WARNING("Не удалось записать файл состояния: " + statusPath);
+    }
+
+    bool pending = false;
+    auto lastStatus = Clock::now();
+    auto lastCleanup = Clock::now();
+    while (!g_stop) {
+        struct pollfd pfd = {watcher.descriptor(), POLLIN, 0};
+        int ready = ::poll(&pfd, 1, 1000);
+        if (ready < 0 && errno != EINTR) {
+            LOG_ERROR("Ошибка ожидания событий inotify: " + std::error_code(errno, std::generic_category()).message());
+            break;
+        }
+        if (ready > 0 && watcher.drain()) pending = true;
+
+        auto now = Clock::now();
+        if (watcher.needsRescan() || (watcher.limitReached() && now - lastRescan >= kLimitRescan)) {
+            LOG_DEBUG("Очередь inotify переполнена или наблюдения неполны: полное пересканирование");
+            watcher.scanAll();
+            lastRescan = now;
+            pending = true;
+        }
+
+        std::vector<bool> selected = crossedGroups(config, cleaner, watcher);
+        bool crossed = false;
+        for (bool group : selected) crossed = crossed || group;
+        if (crossed && (state.cleanups == 0 || now - lastCleanup >= cooldown)) {
+            for (size_t i = 0; i < selected.size(); ++i) {
+                if (!selected[i]) continue;
+                LOG_INFO(concat({"Превышен порог: ", cleaner.groups()[i].scope, " / ", cleaner.groups()[i].name,
+                                 " (", formatSize(watcher.totals()[i].bytes), ")"}));
+            }
+            cleaner.resetScan();
+            cleaner.run(selected);
+            state.cleanups++;
+            state.lastCleanup = unixNow();
+            lastCleanup = Clock::now();
+            // События удаления уже в очереди: итоги после очистки — сразу в состояние
+            watcher.drain();
+            pending = true;
+            lastStatus = Clock::time_point();
+        }
+
+        if (pending && now - lastStatus >= std::chrono::seconds(1)) {
+            if (!writeStatus(statusPath, config, cleaner, watcher, state)) {
+                LOG_WARNING("Не удалось записать файл состояния: " + statusPath);
+            }
+            pending = false;
+            lastStatus = now;
+        }
+    }
+
+    writeStatus(statusPath, config, cleaner, watcher, state);
+    LOG_INFO("Режим наблюдения остановлен");
+    return 0;
+}
+
+#else
+
+int runDaemon(const Config &config, Cleaner &cleaner) {
+    (void)config;
+    (void)cleaner;
+    LOG_ERROR("--daemon поддерживается только в Linux (inotify)");
+    return 1;
+}
+
+#endif
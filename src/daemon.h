@@ -0,0 +1,18 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include "cleaner.h"
+#include "config.h"
+
+/// Режим наблюдения (--daemon): одно полное сканирование целей, затем итоги групп
+/// поддерживаются по событиям inotify (перечитывается только изменившаяся директория).
+/// При превышении порогов ([Thresholds], daemon_threshold) запускается очистка
+/// превысивших групп. Текущие итоги пишутся в файл состояния (JSON) для мониторинга.
+/// Работает до SIGINT/SIGTERM; возвращает код завершения процесса.
+int runDaemon(const Config &config, Cleaner &cleaner);
+
+/// Файл состояния по умолчанию: $XDG_RUNTIME_DIR/kleyner/status.json или ~/.cache/kleyner/status.json.
+/// Путь внутри наблюдаемой цели заменяется служебной директорией, исключённой из целей
+std::string defaultStatusPath();
+
+#endif // DAEMON_H
@@ -0,0 +1,228 @@
+#include "deleter.h"
+#include "profile.h"
+
+#include <algorithm>
+#include <system_error>
+
+// Размер порции элементов, которую обрабатывает одна задача пула
+static const size_t kChunkSize = 256;
+
+Deleter::Deleter(const DeleteOptions &options, ResultFn onResult)
+    : options(options),
+      onResult(std::move(onResult)),
+      opsLimit(options.maxOpsPerSec),
+      bytesLimit(static_cast<double>(options.maxBytesPerSec)),
+      pool(options.jobs) {
+    if (this->options.batchSize == 0) this->options.batchSize = 1;
+}
+
+Deleter::~Deleter() {
+    wait();
+}
+
+void Deleter::add(const PathScan &scan, size_t tag) {
+    const std::vector<ScanEntry> &entries = scan.entries;
+    if (entries.empty()) return;
+    auto batch = std::make_unique<Batch>();
+    batch->scan = &scan;
+    batch->tag = tag;
+    batch->remaining = std::make_unique<std::atomic<uint32_t>[]>(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        batch->remaining[i].store(1, std::memory_order_relaxed);
+    }
+    for (const auto &entry : entries) {
+        if (entry.parent != ScanEntry::noParent) {
+            batch->remaining[entry.parent].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    Batch *raw = batch.get();
+    batches.push_back(std::move(batch));
+
+    // Порции ставятся с конца списка: глубокие элементы освобождаются раньше
+    for (size_t end = entries.size(); end > 0;) {
+        size_t begin = end > kChunkSize ? end - kChunkSize : 0;
+        pool.submit([this, raw, begin, end] { processRange(*raw, begin, end); });
+        end = begin;
+    }
+}
+
+void Deleter::addStream(const std::string &root, size_t tag, bool includeHidden) {
+    bool hidden = options.includeHidden || includeHidden;
+    pool.submit([this, root, tag, hidden] { streamDelete(root, tag, hidden); });
+}
+
+void Deleter::wait() {
+    pool.wait();
+    batches.clear();
+}
+
+void Deleter::processRange(Batch &batch, size_t begin, size_t end) {
+    const std::vector<ScanEntry> &entries = batch.scan->entries;
+    std::vector<size_t> ready;
+    for (size_t i = end; i-- > begin;) {
+        if (batch.remaining[i].fetch_sub(1, std::memory_order_acq_rel) != 1) continue;
+        if (entries[i].directory) {
+            // Пустая (или уже опустевшая) директория
+            std::vector<Pending> one{{entries[i], entryPath(*batch.scan, i)}};
+            execute(nullptr, one, batch.tag);
+            release(batch, entries[i].parent);
+            continue;
+        }
+        ready.push_back(i);
+        if (ready.size() >= options.batchSize) flushFiles(batch, ready);
+    }
+    flushFiles(batch, ready);
+}
+
+/// Удаление накопленных файлов одним пакетом и освобождение их родителей
+void Deleter::flushFiles(Batch &batch, std::vector<size_t> &ready) {
+    if (ready.empty()) return;
+    const std::vector<ScanEntry> &entries = batch.scan->entries;
+    std::vector<Pending> pending;
+    pending.reserve(ready.size());
+    for (size_t index : ready) pending.push_back({entries[index], entryPath(*batch.scan, index)});
+    execute(nullptr, pending, batch.tag);
+    for (size_t index : ready) release(batch, entries[index].parent);
+    ready.clear();
+}
+
+/// Снимает одну блокировку с директории; тот, кто снял последнюю, удаляет её
+/// и поднимается к родителю
+void Deleter::release(Batch &batch, size_t index) {
+    const std::vector<ScanEntry> &entries = batch.scan->entries;
+    while (index != ScanEntry::noParent) {
+        if (batch.remaining[index].fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+        std::vector<Pending> one{{entries[index], entryPath(*batch.scan, index)}};
+        execute(nullptr, one, batch.tag);
+        index = entries[index].parent;
+    }
+}
+
+/// Выполнение пакета удалений с учётом ограничений скорости и одновременных операций
+void Deleter::execute(const DirHandle *parent, std::vector<Pending> &items, size_t tag) {
+    if (items.empty()) return;
+    if (options.dryRun) {
+        for (const Pending &item : items) onResult(item.entry, item.path, tag, true, std::error_code());
+        return;
+    }
+
+    size_t step = items.size();
+    if (options.maxInFlight > 0) step = std::min<size_t>(step, options.maxInFlight);
+    std::vector<RemoveOp> ops;
+    for (size_t begin = 0; begin < items.size(); begin += step) {
+        size_t end = std::min(items.size(), begin + step);
+        ops.clear();
+        for (size_t i = begin; i < end; ++i) {
+            RemoveOp op;
+            op.path = std::move(items[i].path);
+            op.directory = items[i].entry.directory;
+            ops.push_back(std::move(op));
+        }
+
+        // Токены берутся до разрешений на одновременные операции: ждущий поток их не держит
+        opsLimit.acquire(static_cast<double>(ops.size()));
+        if (bytesLimit.enabled()) {
+            std::uintmax_t bytes = 0;
+            for (size_t i = begin; i < end; ++i) {
+                if (!items[i].entry.directory) bytes += items[i].entry.size;
+            }
+            bytesLimit.acquire(static_cast<double>(bytes));
+        }
+
+        unsigned permits = static_cast<unsigned>(ops.size());
+        if (options.maxInFlight > 0) {
+            std::unique_lock<std::mutex> lock(inFlightMutex);
+            inFlightFree.wait(lock, [&] { return inFlight + permits <= options.maxInFlight; });
+            inFlight += permits;
+        }
+        removeBatch(parent, ops);
+        if (options.maxInFlight > 0) {
+            {
+                std::lock_guard<std::mutex> lock(inFlightMutex);
+                inFlight -= permits;
+            }
+            inFlightFree.notify_all();
+        }
+
+        for (size_t i = 0; i < ops.size(); ++i) {
+            onResult(items[begin + i].entry, ops[i].path, tag, ops[i].removed, ops[i].ec);
+        }
+    }
+}
+
+void Deleter::streamDelete(const std::string &root, size_t tag, bool includeHidden) {
+    struct Frame {
+        DirHandle dir;
+        Pending self;
+        bool recorded;                  // Удалять ли саму директорию после её содержимого
+        std::vector<Pending> files;     // Файлы, ожидающие пакетного удаления
+    };
+
+    auto flush = [this, tag](Frame &frame) {
+        if (frame.files.empty()) return;
+        execute(&frame.dir, frame.files, tag);
+        frame.files.clear();
+    };
+
+    std::error_code ec;
+    std::vector<Frame> stack;
+    DirHandle rootDir = DirHandle::open(root, ec);
+    if (ec) return;
+    ScanEntry rootEntry;
+    rootEntry.directory = true;
+    stack.push_back({std::move(rootDir), Pending{rootEntry, root}, false, {}});
+
+    DirItem item;
+    while (!stack.empty()) {
+        Frame &top = stack.back();
+        if (!top.dir.next(item, ec)) {
+            // Директория прочитана: дочищаем файлы и удаляем её саму относительно родителя
+            flush(top);
+            std::vector<Pending> self{std::move(top.self)};
+            bool recorded = top.recorded;
+            stack.pop_back();
+            if (recorded && !stack.empty()) execute(&stack.back().dir, self, tag);
+            ec.clear();
+            continue;
+        }
+
+        PROFILE_COUNT(Entries, 1);
+        Pending entry;
+        entry.path = joinPath(top.dir.path(), item.name);
+        if (isProtectedPath(entry.path) || isExcludedPath(entry.path, options.excluded)) continue;
+        bool recorded = includeHidden || !isHiddenName(item.name);
+
+        EntryKind kind = item.kind;
+        // Размер файла нужен только для ограничения скорости освобождения байт
+        bool needSize = bytesLimit.enabled() && recorded && kind != EntryKind::Directory;
+        if (kind == EntryKind::Unknown || needSize) {
+            FileInfo info;
+            if (top.dir.stat(item.name, info, ec)) {
+                kind = info.kind;
+                entry.entry.size = info.size;
+            }
+            ec.clear();
+        }
+        entry.entry.directory = kind == EntryKind::Directory;
+        if (!entry.entry.directory) {
+            if (recorded) {
+                top.files.push_back(std::move(entry));
+                if (top.files.size() >= options.batchSize) flush(top);
+            }
+            continue;
+        }
+
+        flush(top);
+        DirHandle sub = top.dir.openChild(item.name, ec);
+        if (ec) {
+            // Содержимое недоступно: попытка rmdir сообщит об ошибке так же, как для файла
+            ec.clear();
+            if (recorded) {
+                std::vector<Pending> one{std::move(entry)};
+                execute(&top.dir, one, tag);
+            }
+            continue;
+        }
+        stack.push_back({std::move(sub), std::move(entry), recorded, {}});
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef DELETER_H
+#define DELETER_H
+
+#include "fsops.h"
+#include "scanner.h"
+#include "threadpool.h"
+#include "throttle.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/// Параметры параллельного удаления
+struct DeleteOptions {
+    unsigned jobs = 0;          // Рабочие потоки (0 — по числу ядер)
+    unsigned maxInFlight = 0;   // Максимум одновременных unlink/rmdir (0 — без ограничения)
+    bool includeHidden = false; // Для потокового режима: удалять скрытые элементы
+    bool dryRun = false;        // Ничего не удалять, только сообщать
+    size_t batchSize = 64;      // Файлов в одном пакете удаления (io_uring отправляет пакет разом)
+    double maxOpsPerSec = 0;    // Предел unlink/rmdir в секунду (0 — без ограничения)
+    std::uintmax_t maxBytesPerSec = 0;  // Предел освобождаемых байт в секунду (0 — без ограничения)
+    // Для потокового режима: пути, принадлежащие другим целям
+    const std::unordered_set<std::string> *excluded = nullptr;
+};
+
+/// Планировщик параллельного удаления снимка: файлы удаляются рабочими потоками,
+/// директория — только после того, как удалены все её дети (снизу вверх).
+class Deleter {
+public:
+    /// Результат удаления одного элемента (вызывается из рабочих потоков).
+    /// path — полный путь элемента, tag — метка, с которой дерево поставлено в очередь
+    /// (номер группы целей). removed == false без ошибки — элемента уже не было.
+    using ResultFn = std::function<void(const ScanEntry &, const std::string &path, size_t tag, bool removed,
+                                        const std::error_code &)>;
+
+    Deleter(const DeleteOptions &options, ResultFn onResult);
+    ~Deleter();
+
+    /// Поставить дерево в очередь (элементы в порядке обхода, см. PathScan::entries).
+    /// Снимок должен жить до вызова wait(); полные пути собираются только при удалении.
+    void add(const PathScan &scan, size_t tag = 0);
+
+    /// Потоковое удаление содержимого директории без снимка: обход в глубину
+    /// с удалением в обратном порядке (post-order). Память пропорциональна глубине
+    /// дерева, на каждый элемент — ровно один unlink или rmdir. includeHidden — удалять
+    /// скрытые элементы этого дерева, помимо DeleteOptions::includeHidden.
+    void addStream(const std::string &root, size_t tag = 0, bool includeHidden = false);
+
+    /// Дождаться завершения всех удалений
+    void wait();
+
+private:
+    struct Batch {
+        const PathScan *scan = nullptr;
+        size_t tag = 0;
+        // Для каждого элемента: число неудалённых детей + 1 (за проход своей порции)
+        std::unique_ptr<std::atomic<uint32_t>[]> remaining;
+    };
+
+    DeleteOptions options;
+    ResultFn onResult;
+    std::mutex inFlightMutex;
+    std::condition_variable inFlightFree;
+    unsigned inFlight = 0;
+    TokenBucket opsLimit;
+    TokenBucket bytesLimit;
+    std::deque<std::unique_ptr<Batch>> batches;
+    ThreadPool pool;
+
+    /// Элемент, готовый к удалению: запись снимка и собранный полный путь
+    struct Pending {
+        ScanEntry entry;
+        std::string path;
+    };
+
+    void processRange(Batch &batch, size_t begin, size_t end);
+    void release(Batch &batch, size_t index);
+    void flushFiles(Batch &batch, std::vector<size_t> &ready);
+    void execute(const DirHandle *parent, std::vector<Pending> &items, size_t tag);
+    void streamDelete(const std::string &root, size_t tag, bool includeHidden);
+};
+
+#endif // DELETER_H
@@ -0,0 +1,522 @@
+#include "fsops.h"
+#include "profile.h"
+#include "uring.h"
+
+#include <chrono>
+
+#ifdef CLEANER_LINUX_FS
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// Выбранная реализация; задаётся один раз при запуске, до старта рабочих потоков
+static IO_BACKEND g_backend =
+#ifdef CLEANER_LINUX_FS
+    IO_BACKEND::THREADS;
+#else
+    IO_BACKEND::STD;
+#endif
+
+static bool portableMode() {
+    return g_backend == IO_BACKEND::STD;
+}
+
+IO_BACKEND setIoBackend(IO_BACKEND backend) {
+#ifndef CLEANER_LINUX_FS
+    (void)backend;
+    g_backend = IO_BACKEND::STD;
+#else
+    if (backend == IO_BACKEND::URING) {
+#ifdef CLEANER_URING
+        if (!IoUring::available()) backend = IO_BACKEND::THREADS;
+#else
+        backend = IO_BACKEND::THREADS;
+#endif
+    }
+    g_backend = backend;
+#endif
+    return g_backend;
+}
+
+IO_BACKEND currentIoBackend() {
+    return g_backend;
+}
+
+const char *ioBackendName(IO_BACKEND backend) {
+    switch (backend) {
+    case IO_BACKEND::URING: return "uring";
+    case IO_BACKEND::STD: return "std";
+    default: return "threads";
+    }
+}
+
+std::int64_t fileTimeNow() {
+    // Переносимая реализация берёт mtime из last_write_time: часы file_time_type
+    if (portableMode()) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            fs::file_time_type::clock::now().time_since_epoch()).count();
+    }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::string joinPath(const std::string &dir, const std::string &name) {
+#ifdef CLEANER_LINUX_FS
+    if (!dir.empty() && dir.back() == '/') return dir + name;
+    std::string out;
+    out.reserve(dir.size() + 1 + name.size());
+    out.append(dir).push_back('/');
+    out.append(name);
+    return out;
+#else
+    return (fs::path(dir) / name).string();
+#endif
+}
+
+std::string baseName(const std::string &path) {
+    size_t end = path.size();
+    while (end > 1 && (path[end - 1] == '/' || path[end - 1] == '\\')) --end;
+    size_t slash = path.find_last_of("/\\", end - 1);
+    if (slash == std::string::npos) return path.substr(0, end);
+    return path.substr(slash + 1, end - slash - 1);
+}
+
+static EntryKind kindFromStatus(const fs::file_status &status) {
+    switch (status.type()) {
+    case fs::file_type::regular: return EntryKind::File;
+    case fs::file_type::directory: return EntryKind::Directory;
+    case fs::file_type::symlink: return EntryKind::Symlink;
+    case fs::file_type::none:
+    case fs::file_type::unknown: return EntryKind::Unknown;
+    default: return EntryKind::Other;
+    }
+}
+
+/// Метаданные в переносимой реализации: номер inode недоступен,
+/// занятое место оценивается видимым размером
+static void fillPortableInfo(const fs::path &path, const fs::file_status &status, FileInfo &info) {
+    std::error_code ec;
+    info.kind = kindFromStatus(status);
+    info.size = 0;
+    info.links = 1;
+    if (info.kind == EntryKind::File) {
+        info.size = fs::file_size(path, ec);
+        if (ec) info.size = 0;
+        std::uintmax_t links = fs::hard_link_count(path, ec);
+        if (!ec) info.links = links;
+    }
+    info.allocated = info.size;
+    fs::file_time_type written = fs::last_write_time(path, ec);
+    info.mtime = ec ? 0 : std::chrono::duration_cast<std::chrono::nanoseconds>(written.time_since_epoch()).count();
+}
+
+#ifdef CLEANER_LINUX_FS
+
+// Формат записи getdents64 (в glibc нет публичного объявления для всех версий)
+struct LinuxDirent64 {
+    ino64_t d_ino;
+    off64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+static const size_t kDentsBufferSize = 32 * 1024;
+
+static EntryKind kindFromDType(unsigned char type) {
+    switch (type) {
+    case DT_REG: return EntryKind::File;
+    case DT_DIR: return EntryKind::Directory;
+    case DT_LNK: return EntryKind::Symlink;
+    case DT_UNKNOWN: return EntryKind::Unknown;
+    default: return EntryKind::Other;
+    }
+}
+
+static EntryKind kindFromMode(mode_t mode) {
+    if (S_ISREG(mode)) return EntryKind::File;
+    if (S_ISDIR(mode)) return EntryKind::Directory;
+    if (S_ISLNK(mode)) return EntryKind::Symlink;
+    return EntryKind::Other;
+}
+
+static std::error_code errnoCode(int err) {
+    return std::error_code(err, std::generic_category());
+}
+
+static void fillInfo(const struct stat &st, FileInfo &info) {
+    info.kind = kindFromMode(st.st_mode);
+    info.size = S_ISREG(st.st_mode) ? static_cast<std::uintmax_t>(st.st_size) : 0;
+    info.allocated = static_cast<std::uintmax_t>(st.st_blocks) * 512;
+    info.device = static_cast<std::uint64_t>(st.st_dev);
+    info.inode = static_cast<std::uint64_t>(st.st_ino);
+    info.links = static_cast<std::uint64_t>(st.st_nlink);
+    info.mtime = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    info.ctime = static_cast<std::int64_t>(st.st_ctim.tv_sec) * 1000000000 + st.st_ctim.tv_nsec;
+    info.atime = static_cast<std::int64_t>(st.st_atim.tv_sec) * 1000000000 + st.st_atim.tv_nsec;
+}
+
+DirHandle::~DirHandle() {
+    if (fd >= 0) ::close(fd);
+}
+
+DirHandle::DirHandle(DirHandle &&other) noexcept
+    : dirPath(std::move(other.dirPath)),
+      fd(other.fd),
+      buffer(std::move(other.buffer)),
+      bufferPos(other.bufferPos),
+      bufferEnd(other.bufferEnd),
+      opened(other.opened),
+      it(std::move(other.it)) {
+    other.fd = -1;
+    other.opened = false;
+}
+
+DirHandle &DirHandle::operator=(DirHandle &&other) noexcept {
+    if (this != &other) {
+        if (fd >= 0) ::close(fd);
+        dirPath = std::move(other.dirPath);
+        fd = other.fd;
+        buffer = std::move(other.buffer);
+        bufferPos = other.bufferPos;
+        bufferEnd = other.bufferEnd;
+        opened = other.opened;
+        it = std::move(other.it);
+        other.fd = -1;
+        other.opened = false;
+    }
+    return *this;
+}
+
+#else
+
+DirHandle::~DirHandle() = default;
+DirHandle::DirHandle(DirHandle &&other) noexcept = default;
+DirHandle &DirHandle::operator=(DirHandle &&other) noexcept = default;
+
+#endif
+
+DirHandle DirHandle::open(const std::string &path, std::error_code &ec) {
+    DirHandle handle;
+    PROFILE_COUNT(Open, 1);
+    if (portableMode()) {
+        handle.it = fs::directory_iterator(path, fs::directory_options::skip_permission_denied, ec);
+        if (ec) return handle;
+        handle.opened = true;
+        handle.dirPath = path;
+        return handle;
+    }
+#ifdef CLEANER_LINUX_FS
+    handle.fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (handle.fd < 0) {
+        ec = errnoCode(errno);
+        return handle;
+    }
+    ec.clear();
+    handle.opened = true;
+    handle.dirPath = path;
+#endif
+    return handle;
+}
+
+DirHandle DirHandle::openChild(const std::string &name, std::error_code &ec) const {
+    if (portableMode()) {
+        std::string childPath = joinPath(dirPath, name);
+        if (fs::is_symlink(fs::symlink_status(childPath, ec))) {
+            ec = std::make_error_code(std::errc::not_a_directory);
+            return DirHandle();
+        }
+        return open(childPath, ec);
+    }
+    DirHandle handle;
+    PROFILE_COUNT(Open, 1);
+#ifdef CLEANER_LINUX_FS
+    handle.fd = ::openat(fd, name.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (handle.fd < 0) {
+        ec = errnoCode(errno);
+        return handle;
+    }
+    ec.clear();
+    handle.opened = true;
+    handle.dirPath = joinPath(dirPath, name);
+#endif
+    return handle;
+}
+
+bool DirHandle::next(DirItem &item, std::error_code &ec) {
+    ec.clear();
+    if (!opened) return false;
+    if (portableMode()) {
+        if (it == fs::directory_iterator()) return false;
+        item.name = it->path().filename().string();
+        std::error_code typeEc;
+        item.kind = kindFromStatus(it->symlink_status(typeEc));
+        std::error_code incEc;
+        PROFILE_COUNT(Readdir, 1);
+        it.increment(incEc);
+        if (incEc) it = fs::directory_iterator();
+        return true;
+    }
+#ifdef CLEANER_LINUX_FS
+    while (true) {
+        if (bufferPos >= bufferEnd) {
+            if (buffer.empty()) buffer.resize(kDentsBufferSize);
+            PROFILE_COUNT(Readdir, 1);
+            long n = ::syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+            if (n < 0) {
+                ec = errnoCode(errno);
+                return false;
+            }
+            if (n == 0) return false;
+            bufferPos = 0;
+            bufferEnd = static_cast<size_t>(n);
+        }
+        const auto *entry = reinterpret_cast<const LinuxDirent64 *>(buffer.data() + bufferPos);
+        bufferPos += entry->d_reclen;
+        const char *name = entry->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+        item.name.assign(name);
+        item.kind = kindFromDType(entry->d_type);
+        return true;
+    }
+#else
+    return false;
+#endif
+}
+
+bool DirHandle::stat(const std::string &name, FileInfo &info, std::error_code &ec) const {
+    if (portableMode()) {
+        fs::path childPath = fs::path(dirPath) / name;
+        PROFILE_COUNT(Stat, 1);
+        fs::file_status status = fs::symlink_status(childPath, ec);
+        if (ec) return false;
+        fillPortableInfo(childPath, status, info);
+        return true;
+    }
+#ifdef CLEANER_LINUX_FS
+    struct stat st;
+    PROFILE_COUNT(Stat, 1);
+    if (::fstatat(fd, name.c_str(), &st, AT_SYMLINK_NOFOLLOW) != 0) {
+        ec = errnoCode(errno);
+        return false;
+    }
+    ec.clear();
+    fillInfo(st, info);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void DirHandle::statBatch(std::vector<StatOp> &ops) const {
+#ifdef CLEANER_URING
+    IoUring *ring = g_backend == IO_BACKEND::URING && ops.size() > 1 ? IoUring::threadLocal() : nullptr;
+    if (ring) {
+        std::vector<struct statx> buffers(ops.size());
+        std::vector<IoUring::Op> uringOps(ops.size());
+        for (size_t i = 0; i < ops.size(); ++i) {
+            uringOps[i].type = IoUring::Op::Statx;
+            uringOps[i].dirfd = fd;
+            uringOps[i].path = ops[i].name.c_str();
+            uringOps[i].flags = AT_SYMLINK_NOFOLLOW;
+            uringOps[i].statxBuf = &buffers[i];
+        }
+        PROFILE_COUNT(UringSubmit, 1);
+        // При сбое кольца (run() вернул false) синхронно выполняются только незавершённые
+        ring->run(uringOps);
+        for (size_t i = 0; i < ops.size(); ++i) {
+            if (!uringOps[i].done) {
+                stat(ops[i].name, ops[i].info, ops[i].ec);
+                continue;
+            }
+            PROFILE_COUNT(Stat, 1);
+            if (uringOps[i].res < 0) {
+                ops[i].ec = errnoCode(-uringOps[i].res);
+                continue;
+            }
+            ops[i].ec.clear();
+            const struct statx &stx = buffers[i];
+            ops[i].info.kind = kindFromMode(stx.stx_mode);
+            ops[i].info.size = S_ISREG(stx.stx_mode) ? stx.stx_size : 0;
+            ops[i].info.allocated = static_cast<std::uintmax_t>(stx.stx_blocks) * 512;
+            ops[i].info.device = static_cast<std::uint64_t>(makedev(stx.stx_dev_major, stx.stx_dev_minor));
+            ops[i].info.inode = stx.stx_ino;
+            ops[i].info.links = stx.stx_nlink;
+            ops[i].info.mtime = stx.stx_mtime.tv_sec * 1000000000 + stx.stx_mtime.tv_nsec;
+            ops[i].info.ctime = stx.stx_ctime.tv_sec * 1000000000 + stx.stx_ctime.tv_nsec;
+            ops[i].info.atime = stx.stx_atime.tv_sec * 1000000000 + stx.stx_atime.tv_nsec;
+        }
+        return;
+    }
+#endif
+    for (auto &op : ops) {
+        stat(op.name, op.info, op.ec);
+    }
+}
+
+bool DirHandle::remove(const std::string &name, bool directory, std::error_code &ec) const {
+    if (portableMode()) {
+        return removePath(joinPath(dirPath, name), directory, ec);
+    }
+#ifdef CLEANER_LINUX_FS
+    if (directory) {
+        PROFILE_COUNT(Rmdir, 1);
+    } else {
+        PROFILE_COUNT(Unlink, 1);
+    }
+    if (::unlinkat(fd, name.c_str(), directory ? AT_REMOVEDIR : 0) != 0) {
+        int err = errno;
+        if (err == ENOENT) {
+            ec.clear();
+            return false;
+        }
+        ec = errnoCode(err);
+        return false;
+    }
+    ec.clear();
+    return true;
+#else
+    (void)directory;
+    return false;
+#endif
+}
+
+bool DirHandle::isOpen() const {
+    return opened;
+}
+
+bool statPath(const std::string &path, FileInfo &info, std::error_code &ec) {
+    PROFILE_COUNT(Stat, 1);
+    if (portableMode()) {
+        fs::file_status status = fs::status(path, ec);
+        if (ec) return false;
+        fillPortableInfo(path, status, info);
+        return true;
+    }
+#ifdef CLEANER_LINUX_FS
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) {
+        ec = errnoCode(errno);
+        return false;
+    }
+    ec.clear();
+    fillInfo(st, info);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool diskSpace(const std::string &path, DiskSpace &space, std::error_code &ec) {
+#ifdef CLEANER_LINUX_FS
+    struct statvfs st;
+    if (::statvfs(path.c_str(), &st) != 0) {
+        ec = errnoCode(errno);
+        return false;
+    }
+    ec.clear();
+    space.id = static_cast<std::uint64_t>(st.f_fsid);
+    struct stat root;
+    if (space.id == 0 && ::stat(path.c_str(), &root) == 0) space.id = static_cast<std::uint64_t>(root.st_dev);
+    space.capacity = static_cast<std::uintmax_t>(st.f_blocks) * st.f_frsize;
+    space.free = static_cast<std::uintmax_t>(st.f_bfree) * st.f_frsize;
+    space.available = static_cast<std::uintmax_t>(st.f_bavail) * st.f_frsize;
+    return true;
+#else
+    fs::space_info info = fs::space(path, ec);
+    if (ec) return false;
+    space.id = 0;
+    space.capacity = info.capacity;
+    space.free = info.free;
+    space.available = info.available;
+    return true;
+#endif
+}
+
+bool removePath(const std::string &path, bool directory, std::error_code &ec) {
+    if (directory) {
+        PROFILE_COUNT(Rmdir, 1);
+    } else {
+        PROFILE_COUNT(Unlink, 1);
+    }
+    if (portableMode()) {
+        return fs::remove(path, ec);
+    }
+#ifdef CLEANER_LINUX_FS
+    int rc = directory ? ::rmdir(path.c_str()) : ::unlink(path.c_str());
+    if (rc != 0) {
+        int err = errno;
+        if (err == ENOENT) {
+            ec.clear();
+            return false;
+        }
+        ec = errnoCode(err);
+        return false;
+    }
+    ec.clear();
+    return true;
+#else
+    (void)directory;
+    return false;
+#endif
+}
+
+void removeBatch(const DirHandle *parent, std::vector<RemoveOp> &ops) {
+#ifdef CLEANER_URING
+    IoUring *ring = g_backend == IO_BACKEND::URING && ops.size() > 1 ? IoUring::threadLocal() : nullptr;
+    if (ring) {
+        std::vector<std::string> names;
+        if (parent) {
+            names.reserve(ops.size());
+            for (const auto &op : ops) names.push_back(baseName(op.path));
+        }
+        std::vector<IoUring::Op> uringOps(ops.size());
+        for (size_t i = 0; i < ops.size(); ++i) {
+            uringOps[i].type = IoUring::Op::Unlinkat;
+            uringOps[i].dirfd = parent ? parent->fd : AT_FDCWD;
+            uringOps[i].path = parent ? names[i].c_str() : ops[i].path.c_str();
+            uringOps[i].flags = ops[i].directory ? AT_REMOVEDIR : 0;
+        }
+        PROFILE_COUNT(UringSubmit, 1);
+        // При сбое кольца (run() вернул false) повторяются только незавершённые удаления:
+        // выполненное второй раз дало бы ENOENT и потерю учёта
+        ring->run(uringOps);
+        for (size_t i = 0; i < ops.size(); ++i) {
+            if (!uringOps[i].done) {
+                ops[i].removed = parent
+                    ? parent->remove(names[i], ops[i].directory, ops[i].ec)
+                    : removePath(ops[i].path, ops[i].directory, ops[i].ec);
+                continue;
+            }
+            if (ops[i].directory) {
+                PROFILE_COUNT(Rmdir, 1);
+            } else {
+                PROFILE_COUNT(Unlink, 1);
+            }
+            int res = uringOps[i].res;
+            ops[i].removed = res >= 0;
+            if (res < 0 && res != -ENOENT) {
+                ops[i].ec = errnoCode(-res);
+            } else {
+                ops[i].ec.clear();
+            }
+        }
+        return;
+    }
+#endif
+    for (auto &op : ops) {
+        op.removed = parent
+            ? parent->remove(baseName(op.path), op.directory, op.ec)
+            : removePath(op.path, op.directory, op.ec);
+    }
+}
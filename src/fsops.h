@@ -0,0 +1,150 @@
+#ifndef FSOPS_H
+#define FSOPS_H
+
+#include "config.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+// Быстрый путь для Linux: работа относительно открытых дескрипторов директорий
+// (openat/fstatat/unlinkat/getdents64). Переносимая реализация на std::filesystem
+// выбирается при сборке с -DCLEANER_PORTABLE_FS=ON и на остальных платформах,
+// а на Linux — ещё и во время работы через --io-backend std.
+#if defined(__linux__) && !defined(CLEANER_PORTABLE_FS)
+#define CLEANER_LINUX_FS 1
+#endif
+
+/// Тип элемента директории
+enum class EntryKind {
+    Unknown,
+    File,
+    Directory,
+    Symlink,
+    Other
+};
+
+/// Элемент, прочитанный из директории (тип известен без stat, если ФС его отдаёт)
+struct DirItem {
+    std::string name;
+    EntryKind kind = EntryKind::Unknown;
+};
+
+/// Метаданные элемента (без перехода по символическим ссылкам)
+struct FileInfo {
+    EntryKind kind = EntryKind::Unknown;
+    std::uintmax_t size = 0;        // Видимый размер (st_size)
+    std::uintmax_t allocated = 0;   // Занято на диске (st_blocks * 512)
+    std::uint64_t device = 0;       // st_dev и st_ino; 0 — неизвестны (переносимая реализация)
+    std::uint64_t inode = 0;
+    std::uint64_t links = 1;        // Число жёстких ссылок
+    std::int64_t mtime = 0;         // Время изменения содержимого, нс
+    std::int64_t ctime = 0;         // Время изменения метаданных, нс (0 — неизвестно)
+    std::int64_t atime = 0;         // Время последнего доступа, нс (0 — неизвестно)
+};
+
+/// Запрос метаданных в пакете
+struct StatOp {
+    std::string name;
+    FileInfo info;
+    std::error_code ec;
+};
+
+/// Удаление в пакете (полный путь; при наличии родителя удаляется его ребёнок с этим именем)
+struct RemoveOp {
+    std::string path;
+    bool directory = false;
+    bool removed = false;   // false без ошибки — элемента уже не было
+    std::error_code ec;
+};
+
+/// Выбор реализации файловых операций во время работы.
+/// Возвращает фактически включённую реализацию (с откатом, если запрошенная недоступна).
+IO_BACKEND setIoBackend(IO_BACKEND backend);
+IO_BACKEND currentIoBackend();
+const char *ioBackendName(IO_BACKEND backend);
+
+/// Текущее время в единицах FileInfo::mtime/atime (нс; эпоха зависит от реализации)
+std::int64_t fileTimeNow();
+
+class DirHandle;
+void removeBatch(const DirHandle *parent, std::vector<RemoveOp> &ops);
+
+/// Открытая директория. На Linux держит дескриптор, и все операции над детьми
+/// выполняются относительно него без повторного разбора полного пути.
+class DirHandle {
+public:
+    DirHandle() = default;
+    ~DirHandle();
+    DirHandle(DirHandle &&other) noexcept;
+    DirHandle &operator=(DirHandle &&other) noexcept;
+    DirHandle(const DirHandle &) = delete;
+    DirHandle &operator=(const DirHandle &) = delete;
+
+    /// Открыть директорию по полному пути
+    static DirHandle open(const std::string &path, std::error_code &ec);
+
+    /// Открыть поддиректорию по имени (символические ссылки не раскрываются)
+    DirHandle openChild(const std::string &name, std::error_code &ec) const;
+
+    /// Следующий элемент ("." и ".." пропускаются); false — конец или ошибка в ec
+    bool next(DirItem &item, std::error_code &ec);
+
+    /// Метаданные ребёнка по имени
+    bool stat(const std::string &name, FileInfo &info, std::error_code &ec) const;
+
+    /// Метаданные нескольких детей (с io_uring — одним пакетом)
+    void statBatch(std::vector<StatOp> &ops) const;
+
+    /// Удалить ребёнка: файл (unlink) или пустую директорию (rmdir).
+    /// Возвращает false без ошибки, если элемента уже нет.
+    bool remove(const std::string &name, bool directory, std::error_code &ec) const;
+
+    bool isOpen() const;
+    const std::string &path() const { return dirPath; }
+
+private:
+    friend void removeBatch(const DirHandle *parent, std::vector<RemoveOp> &ops);
+
+    std::string dirPath;
+#ifdef CLEANER_LINUX_FS
+    int fd = -1;
+    std::vector<char> buffer;
+    size_t bufferPos = 0;
+    size_t bufferEnd = 0;
+#endif
+    bool opened = false;
+    std::filesystem::directory_iterator it;   // Переносимая реализация
+};
+
+/// Соединение пути директории и имени ребёнка
+std::string joinPath(const std::string &dir, const std::string &name);
+
+/// Последний компонент пути
+std::string baseName(const std::string &path);
+
+/// Метаданные по полному пути; символические ссылки раскрываются, как у корня цели
+bool statPath(const std::string &path, FileInfo &info, std::error_code &ec);
+
+/// Место на файловой системе
+struct DiskSpace {
+    std::uint64_t id = 0;               // Идентификатор ФС (f_fsid; 0 — неизвестен)
+    std::uintmax_t capacity = 0;
+    std::uintmax_t free = 0;            // Свободно, включая резерв root
+    std::uintmax_t available = 0;       // Доступно непривилегированному пользователю
+};
+
+/// Место на ФС, содержащей path (statvfs, в переносимой реализации — std::filesystem::space)
+bool diskSpace(const std::string &path, DiskSpace &space, std::error_code &ec);
+
+/// Удаление по полному пути, тип элемента известен заранее (без лишнего stat).
+/// Возвращает false без ошибки, если элемента уже нет.
+bool removePath(const std::string &path, bool directory, std::error_code &ec);
+
+/// Пакетное удаление: относительно parent или по полным путям (parent == nullptr).
+/// С io_uring все операции пакета отправляются разом.
+void removeBatch(const DirHandle *parent, std::vector<RemoveOp> &ops);
+
+#endif // FSOPS_H
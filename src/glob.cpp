@@ -0,0 +1,358 @@
+#include "glob.h"
+#include "fsops.h"
+#include "profile.h"
+
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <system_error>
+
+bool GlobSet::CharClass::contains(unsigned char c) const {
+    bool found = false;
+    for (const auto &range : ranges) {
+        if (c >= range.first && c <= range.second) {
+            found = true;
+            break;
+        }
+    }
+    return found != negated;
+}
+
+bool GlobSet::Segment::match(const std::string &name) const {
+    if (kind == Literal) return name == text;
+    if (kind == Recursive) return true;
+    if (hasStar ? name.size() < minLength : name.size() != minLength) return false;
+    if (name.compare(0, prefix.size(), prefix) != 0) return false;
+    if (!suffix.empty() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) return false;
+
+    auto single = [&](const Token &token, char c) {
+        switch (token.type) {
+        case Token::Char: return token.c == c;
+        case Token::Any: return true;
+        case Token::Class: return classes[token.cls].contains(static_cast<unsigned char>(c));
+        default: return false;
+        }
+    };
+    size_t t = 0;
+    size_t p = 0;
+    size_t star = std::string::npos;
+    size_t mark = 0;
+    while (t < name.size()) {
+        if (p < tokens.size() && tokens[p].type != Token::Star && single(tokens[p], name[t])) {
+            ++t;
+            ++p;
+        } else if (p < tokens.size() && tokens[p].type == Token::Star) {
+            star = p++;
+            mark = t;
+        } else if (star != std::string::npos) {
+            p = star + 1;
+            t = ++mark;
+        } else {
+            return false;
+        }
+    }
+    while (p < tokens.size() && tokens[p].type == Token::Star) ++p;
+    return p == tokens.size();
+}
+
+bool GlobSet::State::operator<(const State &other) const {
+    return pattern != other.pattern ? pattern < other.pattern : segment < other.segment;
+}
+
+bool GlobSet::State::operator==(const State &other) const {
+    return pattern == other.pattern && segment == other.segment;
+}
+
+bool GlobSet::isPattern(const std::string &path) {
+    return path.find_first_of("*?[{") != std::string::npos;
+}
+
+/// Раскрытие {a,b}: первая пара скобок с запятой на верхнем уровне, остальное — рекурсивно
+std::vector<std::string> GlobSet::expandBraces(const std::string &pattern) {
+    for (size_t open = pattern.find('{'); open != std::string::npos; open = pattern.find('{', open + 1)) {
+        int depth = 0;
+        size_t close = std::string::npos;
+        std::vector<size_t> commas;
+        for (size_t i = open; i < pattern.size(); ++i) {
+            if (pattern[i] == '{') {
+                ++depth;
+            } else if (pattern[i] == '}') {
+                if (--depth == 0) {
+                    close = i;
+                    break;
+                }
+            } else if (pattern[i] == ',' && depth == 1) {
+                commas.push_back(i);
+            }
+        }
+        if (close == std::string::npos) break;
+        if (commas.empty()) continue;
+
+        std::string head = pattern.substr(0, open);
+        std::string tail = pattern.substr(close + 1);
+        std::vector<std::string> result;
+        size_t begin = open + 1;
+        commas.push_back(close);
+        for (size_t comma : commas) {
+            for (auto &alternative : expandBraces(head + pattern.substr(begin, comma - begin) + tail)) {
+                result.push_back(std::move(alternative));
+            }
+            begin = comma + 1;
+        }
+        return result;
+    }
+    return {pattern};
+}
+
+GlobSet::Segment GlobSet::compileSegment(const std::string &text) {
+    Segment segment;
+    segment.text = text;
+    if (text == "**") {
+        segment.kind = Segment::Recursive;
+        return segment;
+    }
+
+    bool magic = false;
+    for (size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        if (c == '*') {
+            if (segment.tokens.empty() || segment.tokens.back().type != Token::Star) {
+                segment.tokens.push_back({Token::Star});
+            }
+            magic = true;
+            continue;
+        }
+        if (c == '?') {
+            segment.tokens.push_back({Token::Any});
+            magic = true;
+            continue;
+        }
+        if (c == '[') {
+            // Класс символов; без закрывающей скобки '[' — обычный символ
+            size_t j = i + 1;
+            CharClass cls;
+            if (j < text.size() && (text[j] == '!' || text[j] == '^')) {
+                cls.negated = true;
+                ++j;
+            }
+            size_t first = j;
+            while (j < text.size() && (text[j] != ']' || j == first)) {
+                unsigned char low = static_cast<unsigned char>(text[j]);
+                if (j + 2 < text.size() && text[j + 1] == '-' && text[j + 2] != ']') {
+                    cls.ranges.emplace_back(low, static_cast<unsigned char>(text[j + 2]));
+                    j += 3;
+                } else {
+                    cls.ranges.emplace_back(low, low);
+                    ++j;
+                }
+            }
+            if (j < text.size()) {
+                Token token{Token::Class};
+                token.cls = static_cast<std::uint32_t>(segment.classes.size());
+                segment.classes.push_back(std::move(cls));
+                segment.tokens.push_back(token);
+                magic = true;
+                i = j;
+                continue;
+            }
+        }
+        Token token{Token::Char};
+        token.c = c;
+        segment.tokens.push_back(token);
+    }
+    if (!magic) {
+        segment.tokens.clear();
+        return segment;
+    }
+
+    segment.kind = Segment::Wild;
+    for (const Token &token : segment.tokens) {
+        if (token.type == Token::Star) {
+            segment.hasStar = true;
+        } else {
+            segment.minLength++;
+        }
+    }
+    for (const Token &token : segment.tokens) {
+        if (token.type != Token::Char) break;
+        segment.prefix.push_back(token.c);
+    }
+    if (segment.hasStar) {
+        for (auto it = segment.tokens.rbegin(); it != segment.tokens.rend() && it->type == Token::Char; ++it) {
+            segment.suffix.insert(segment.suffix.begin(), it->c);
+        }
+    }
+    return segment;
+}
+
+size_t GlobSet::add(const std::string &pattern) {
+    std::string norm = pattern;
+    std::replace(norm.begin(), norm.end(), '\\', '/');
+    for (const auto &alternative : expandBraces(norm)) {
+        Compiled entry;
+        entry.owner = count;
+        size_t start = 0;
+        if (alternative.size() >= 3 && std::isalpha(static_cast<unsigned char>(alternative[0])) &&
+            alternative[1] == ':' && alternative[2] == '/') {
+            entry.root = alternative.substr(0, 3);
+            start = 3;
+        } else if (!alternative.empty() && alternative[0] == '/') {
+            entry.root = "/";
+            start = 1;
+        } else {
+            entry.root = ".";
+        }
+        bool literal = true;
+        for (size_t i = start; i <= alternative.size();) {
+            size_t slash = alternative.find('/', i);
+            if (slash == std::string::npos) slash = alternative.size();
+            if (slash > i) {
+                entry.segments.push_back(compileSegment(alternative.substr(i, slash - i)));
+                literal = literal && entry.segments.back().kind == Segment::Literal;
+            }
+            i = slash + 1;
+        }
+        if (literal) {
+            literals.emplace_back(count, alternative);
+        } else {
+            compiled.push_back(std::move(entry));
+        }
+    }
+    return count++;
+}
+
+/// `**` может не съесть ни одного уровня: шаблон сразу переходит к следующему сегменту
+void GlobSet::closure(std::vector<State> &states) const {
+    for (size_t i = 0; i < states.size(); ++i) {
+        const Compiled &entry = compiled[states[i].pattern];
+        if (states[i].segment < entry.segments.size() &&
+            entry.segments[states[i].segment].kind == Segment::Recursive) {
+            states.push_back({states[i].pattern, states[i].segment + 1});
+        }
+    }
+    std::sort(states.begin(), states.end());
+    states.erase(std::unique(states.begin(), states.end()), states.end());
+}
+
+void GlobSet::walk(const std::string &dir, std::vector<State> states, PathArena &arena,
+                   std::vector<std::vector<std::string_view>> &out) const {
+    closure(states);
+    bool needRead = false;
+    std::string_view stored;
+    for (const State &state : states) {
+        const Compiled &entry = compiled[state.pattern];
+        if (state.segment == entry.segments.size()) {
+            if (stored.empty()) stored = arena.store(dir);
+            out[entry.owner].push_back(stored);
+        } else if (entry.segments[state.segment].kind != Segment::Literal) {
+            needRead = true;
+        }
+    }
+
+    // Совпадение, которому нечего сопоставлять дальше, записывается сразу, без
+    // рекурсивного вызова для каждого из (возможно, сотен тысяч) найденных файлов
+    auto complete = [&](const std::vector<State> &next) {
+        for (const State &state : next) {
+            if (state.segment < compiled[state.pattern].segments.size()) return false;
+        }
+        return true;
+    };
+    auto record = [&](const std::string &path, const std::vector<State> &next) {
+        std::string_view view = arena.store(path);
+        for (const State &state : next) out[compiled[state.pattern].owner].push_back(view);
+    };
+
+    // Продолжения, которым нужна директория, отбрасываются у файлов
+    auto keepMatching = [&](std::vector<State> &next, bool isDirectory) {
+        if (isDirectory) return;
+        next.erase(std::remove_if(next.begin(), next.end(), [&](const State &state) {
+            return state.segment < compiled[state.pattern].segments.size();
+        }), next.end());
+    };
+
+    std::vector<std::pair<std::string, std::vector<State>>> children;
+    if (needRead) {
+        // Одно чтение директории на все шаблоны, которым она нужна
+        std::error_code ec;
+        DirHandle handle = DirHandle::open(dir, ec);
+        if (ec) return;
+        DirItem item;
+        std::vector<State> next;
+        while (handle.next(item, ec)) {
+            EntryKind kind = item.kind;
+            next.clear();
+            for (const State &state : states) {
+                const Compiled &entry = compiled[state.pattern];
+                if (state.segment == entry.segments.size()) continue;
+                const Segment &segment = entry.segments[state.segment];
+                if (segment.kind == Segment::Recursive) {
+                    if (kind == EntryKind::Unknown) {
+                        FileInfo info;
+                        std::error_code statEc;
+                        if (handle.stat(item.name, info, statEc)) kind = info.kind;
+                    }
+                    // В глубину `**` идёт только по настоящим директориям
+                    if (kind == EntryKind::Directory) next.push_back(state);
+                } else if (segment.match(item.name)) {
+                    next.push_back({state.pattern, state.segment + 1});
+                }
+            }
+            if (next.empty()) continue;
+            std::string path = joinPath(dir, item.name);
+            bool isDirectory = kind == EntryKind::Directory;
+            if (!isDirectory && kind != EntryKind::File && kind != EntryKind::Other) {
+                FileInfo info;
+                std::error_code statEc;
+                isDirectory = statPath(path, info, statEc) && info.kind == EntryKind::Directory;
+            }
+            keepMatching(next, isDirectory);
+            if (next.empty()) continue;
+            if (complete(next)) {
+                record(path, next);
+            } else {
+                children.emplace_back(std::move(path), next);
+            }
+        }
+    } else {
+        // Только буквальные имена: проверяем их напрямую, без чтения директории
+        std::map<std::string, std::vector<State>> byName;
+        for (const State &state : states) {
+            const Compiled &entry = compiled[state.pattern];
+            if (state.segment == entry.segments.size()) continue;
+            byName[entry.segments[state.segment].text].push_back({state.pattern, state.segment + 1});
+        }
+        for (auto &named : byName) {
+            std::string path = joinPath(dir, named.first);
+            FileInfo info;
+            std::error_code ec;
+            if (!statPath(path, info, ec)) continue;
+            keepMatching(named.second, info.kind == EntryKind::Directory);
+            if (named.second.empty()) continue;
+            if (complete(named.second)) {
+                record(path, named.second);
+            } else {
+                children.emplace_back(std::move(path), std::move(named.second));
+            }
+        }
+    }
+
+    for (auto &child : children) walk(child.first, std::move(child.second), arena, out);
+}
+
+std::vector<std::vector<std::string_view>> GlobSet::expand(PathArena &arena) const {
+    PROFILE_SCOPE("GlobSet::expand");
+    std::vector<std::vector<std::string_view>> out(count);
+    for (const auto &literal : literals) out[literal.first].push_back(arena.store(literal.second));
+
+    std::map<std::string, std::vector<State>> roots;
+    for (size_t i = 0; i < compiled.size(); ++i) {
+        roots[compiled[i].root].push_back({static_cast<std::uint32_t>(i), 0});
+    }
+    for (auto &root : roots) walk(root.first, std::move(root.second), arena, out);
+
+    for (auto &paths : out) {
+        std::sort(paths.begin(), paths.end());
+        paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+    }
+    return out;
+}
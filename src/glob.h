@@ -0,0 +1,86 @@
+#ifndef GLOB_H
+#define GLOB_H
+
+#include "patharena.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// Набор шаблонов путей, разворачиваемых за один проход по ФС.
+/// Синтаксис сегмента: `*`, `?`, классы `[abc]`, `[a-z]`, `[!x]`; отдельный
+/// сегмент `**` — любое число уровней, включая ноль (по символическим ссылкам не
+/// спускается; `**` в конце шаблона даёт директории, их содержимое и так войдёт в цель);
+/// `{a,b}` — варианты (раскрываются до сопоставления, могут быть вложенными).
+/// Шаблоны компилируются один раз; директория, нужная нескольким шаблонам
+/// (например, `/var/log/*.log.1` и `/var/log/*.gz`), читается один раз,
+/// а поддеревья, которые не может продолжить ни один шаблон, не открываются.
+class GlobSet {
+public:
+    /// Есть ли в пути символы шаблона
+    static bool isPattern(const std::string &path);
+
+    /// Добавить шаблон (разделители `\` допускаются); возвращает его номер
+    size_t add(const std::string &pattern);
+
+    /// Развернуть все шаблоны: для каждого номера — отсортированные пути без повторов.
+    /// Варианты `{a,b}` без других символов шаблона возвращаются как есть, без проверки
+    /// существования, как и обычные пути целей. Строки путей хранятся в arena.
+    std::vector<std::vector<std::string_view>> expand(PathArena &arena) const;
+
+private:
+    struct CharClass {
+        bool negated = false;
+        std::vector<std::pair<unsigned char, unsigned char>> ranges;
+        bool contains(unsigned char c) const;
+    };
+
+    struct Token {
+        enum Type : std::uint8_t { Char, Any, Class, Star } type;
+        char c = 0;
+        std::uint32_t cls = 0;      // Индекс в Segment::classes
+    };
+
+    /// Скомпилированный сегмент пути
+    struct Segment {
+        enum Kind : std::uint8_t { Literal, Wild, Recursive } kind = Literal;
+        std::string text;               // Literal: имя целиком
+        std::vector<Token> tokens;      // Wild
+        std::vector<CharClass> classes;
+        std::string prefix;             // Буквальное начало и конец имени: быстрый отказ
+        std::string suffix;             // без полного сопоставления
+        size_t minLength = 0;
+        bool hasStar = false;
+
+        bool match(const std::string &name) const;
+    };
+
+    struct Compiled {
+        size_t owner;                   // Номер исходного шаблона
+        std::string root;               // "/", "C:/" или "."
+        std::vector<Segment> segments;
+    };
+
+    /// Шаблон в точке обхода: какой сегмент ещё предстоит сопоставить
+    struct State {
+        std::uint32_t pattern;
+        std::uint32_t segment;
+        bool operator<(const State &other) const;
+        bool operator==(const State &other) const;
+    };
+
+    size_t count = 0;
+    std::vector<Compiled> compiled;
+    std::vector<std::pair<size_t, std::string>> literals;   // Варианты без символов шаблона
+
+    static std::vector<std::string> expandBraces(const std::string &pattern);
+    static Segment compileSegment(const std::string &text);
+
+    void closure(std::vector<State> &states) const;
+    void walk(const std::string &dir, std::vector<State> states, PathArena &arena,
+              std::vector<std::vector<std::string_view>> &out) const;
+};
+
+#endif // GLOB_H
@@ -1,7 +1,13 @@
 #include "logger.h"
-#include <iostream>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
 #include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 // Глобальная переменная для уровня логирования
 static bool g_verbose = false;
@@ -11,34 +17,194 @@ void initLogger(bool verbose) {
     g_verbose = verbose;
 }
 
-/// Вспомогательная функция для получения текущей временной метки
-// Вспомогательная функция для получения текущей временной метки
-static std::string currentTimestamp() {
-    auto now = std::chrono::system_clock::now();
-    std::time_t now_time = std::chrono::system_clock::to_time_t(now);
-    char buffer[100];
-
-    std::tm* tm = std::localtime(&now_time);
-    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", tm); // Форматируем как "2025-03-29 12:34:56"
-    
-    return std::string(buffer);
+namespace {
+
+/// Асинхронный вывод: рабочие потоки кладут сообщения в кольцевой буфер без блокировок
+/// (MPSC, ячейки с номерами последовательности), а отдельный поток форматирует
+/// временные метки и пишет накопленное крупными порциями.
+class AsyncLogger {
+public:
+    AsyncLogger() : slots(new Slot[kCapacity]) {
+        for (size_t i = 0; i < kCapacity; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        writer = std::thread([this] { writeLoop(); });
+    }
+
+    /// Дописывает всё, что осталось в буфере, до завершения программы
+    ~AsyncLogger() {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        writer.join();
+    }
+
+    void push(LogLevel level, const std::string &msg) {
+        std::time_t time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot &slot = slots[pos & kMask];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                // Буфер заполнен: сообщения не теряем, ждём, пока писатель освободит место
+                notifyWriter();
+                std::this_thread::yield();
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        Slot &slot = slots[pos & kMask];
+        slot.level = level;
+        slot.time = time;
+        slot.text = msg;
+        slot.sequence.store(pos + 1, std::memory_order_release);
+        if (writerSleeping.load()) notifyWriter();
+    }
+
+    /// Дождаться, пока все сообщения, отправленные до вызова, будут записаны
+    void flush() {
+        size_t target = enqueuePos.load(std::memory_order_acquire);
+        notifyWriter();
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        flushed.wait(lock, [&] { return written.load(std::memory_order_acquire) >= target; });
+    }
+
+private:
+    static const size_t kCapacity = 4096;
+    static const size_t kMask = kCapacity - 1;
+    static const size_t kBatchBytes = 64 * 1024;   // Порция одного fwrite
+
+    struct Slot {
+        std::atomic<size_t> sequence{0};
+        LogLevel level = INFO;
+        std::time_t time = 0;
+        std::string text;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    alignas(64) std::atomic<size_t> enqueuePos{0};
+    alignas(64) size_t dequeuePos = 0;              // Только поток писателя
+    std::atomic<size_t> written{0};                 // Сколько сообщений уже выведено
+    std::atomic<bool> writerSleeping{false};
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    std::condition_variable flushed;
+    bool stopping = false;
+    std::thread writer;
+
+    // Кэш временной метки: strftime вызывается не чаще раза в секунду
+    std::time_t cachedTime = -1;
+    char cachedStamp[32] = {0};
+
+    void notifyWriter() {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        wake.notify_one();
+    }
+
+    const char *timestamp(std::time_t time) {
+        if (time != cachedTime) {
+            cachedTime = time;
+            std::tm tm{};
+#ifdef _WIN32
+            localtime_s(&tm, &time);
+#else
+            localtime_r(&time, &tm);
+#endif
+            std::strftime(cachedStamp, sizeof(cachedStamp), "%Y-%m-%d %H:%M:%S", &tm); // Форматируем как "2025-03-29 12:34:56"
+        }
+        return cachedStamp;
+    }
+
+    static const char *levelName(LogLevel level) {
+        switch (level) {
+        case DEBUG: return "DEBUG";
+        case ERROR: return "ERROR";
+        case WARNING: return "WARNING";
+        default: return "INFO";
+        }
+    }
+
+    static void writeOut(std::FILE *stream, std::string &buffer) {
+        if (buffer.empty()) return;
+        std::fwrite(buffer.data(), 1, buffer.size(), stream);
+        std::fflush(stream);
+        buffer.clear();
+    }
+
+    void writeLoop() {
+        std::string out;
+        std::string err;
+        for (;;) {
+            size_t taken = 0;
+            for (;;) {
+                Slot &slot = slots[dequeuePos & kMask];
+                if (slot.sequence.load(std::memory_order_acquire) != dequeuePos + 1) break;
+                // Ошибки идут в stderr; при смене потока сбрасываем другой, чтобы сохранить порядок
+                bool toErr = slot.level == ERROR;
+                std::FILE *stream = toErr ? stderr : stdout;
+                std::string &target = toErr ? err : out;
+                writeOut(toErr ? stdout : stderr, toErr ? out : err);
+                target.append("[").append(timestamp(slot.time)).append("][")
+                      .append(levelName(slot.level)).append("] ").append(slot.text).push_back('\n');
+                slot.text.clear();
+                slot.sequence.store(dequeuePos + kCapacity, std::memory_order_release);
+                ++dequeuePos;
+                ++taken;
+                if (target.size() >= kBatchBytes) writeOut(stream, target);
+            }
+            writeOut(stdout, out);
+            writeOut(stderr, err);
+            if (taken > 0) {
+                {
+                    std::lock_guard<std::mutex> lock(wakeMutex);
+                    written.store(dequeuePos, std::memory_order_release);
+                }
+                flushed.notify_all();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            writerSleeping.store(true);
+            Slot &next = slots[dequeuePos & kMask];
+            if (next.sequence.load(std::memory_order_acquire) != dequeuePos + 1) {
+                if (stopping) break;
+                wake.wait_for(lock, std::chrono::milliseconds(100));
+            }
+            writerSleeping.store(false);
+        }
+    }
+};
+
+AsyncLogger &logger() {
+    static AsyncLogger instance;
+    return instance;
 }
 
+} // namespace
+
+void flushLogger() {
+    logger().flush();
+}
 
 void LOG_INFO(const std::string &msg) {
-    std::cout << "[" << currentTimestamp() << "][INFO] " << msg << std::endl;
+    logger().push(INFO, msg);
 }
 
 void LOG_DEBUG(const std::string &msg) {
-    if (g_verbose)
-        std::cout << "[" << currentTimestamp() << "][DEBUG] " << msg << std::endl;
+    if (!g_verbose) return;
+    logger().push(DEBUG, msg);
 }
 
 void LOG_ERROR(const std::string &msg) {
-    std::cerr << "[" << currentTimestamp() << "][ERROR] " << msg << std::endl;
+    logger().push(ERROR, msg);
 }
 
 void LOG_WARNING(const std::string &msg) {
-    std::string logMessage = "[" + currentTimestamp() + "][WARNING] " + msg;
-    std::cout << logMessage << std::endl;
+    logger().push(WARNING, msg);
 }
@@ -14,6 +14,9 @@ enum LogLevel {
 // Инициализация логгера с учетом подробного режима (verbose)
 void initLogger(bool verbose);
 
+// Дождаться вывода всех сообщений (вызывается перед вопросом пользователю)
+void flushLogger();
+
 // Логирование информационных сообщений
 void LOG_INFO(const std::string &msg);
 
@@ -1,10 +1,19 @@
 #include "config.h"
 #include "logger.h"
 #include "cleaner.h"
+#include "daemon.h"
 #include "utils.h"
+#include "fsops.h"
+#include "pathlookup.h"
+#include "process.h"
+#include "profile.h"
+#include "report.h"
+#include "scanner.h"
+#include "trash.h"
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <tuple>
 #include <filesystem>
 #include <vector>
@@ -60,13 +69,22 @@ static std::vector<std::string> findPythonEnvironments() {
 }
 
 static void handlePythonEnvironments(const Config &config) {
+    PROFILE_SCOPE("handlePythonEnvironments");
     LOG_INFO("Проверка Python-окружений...");
     const double threshold = 3.0; // GB
     for (const auto &env : findPythonEnvironments()) {
-        auto size = directorySize(env);
+        ScanOptions options;
+        options.includeHidden = true;
+        options.jobs = config.jobs;
+        options.keepEntries = false;
+        options.inodeAccounting = config.inodeAccounting;
+        PathScan scan = scanPath(env, options);
+        // При учёте по inode порог сравнивается с тем, что реально освободится
+        auto size = config.inodeAccounting ? scan.reclaimableBytes : scan.bytes;
         double sizeGb = static_cast<double>(size) / (1024 * 1024 * 1024);
         if (sizeGb < threshold) continue;
 
+        flushLogger();
         std::cout << "Обнаружено Python окружение: " << env
                   << " (" << sizeGb << " GB). Удалить? (y/n): ";
         std::string ans;
@@ -86,76 +104,95 @@ static void handlePythonEnvironments(const Config &config) {
     }
 }
 
-static bool commandExists(const std::string &cmd) {
-#ifdef _WIN32
-    std::string check = "where " + cmd + " >nul 2>&1";
-#else
-    std::string check = "command -v " + cmd + " >/dev/null 2>&1";
-#endif
-    return std::system(check.c_str()) == 0;
-}
+/// Итоги CLI-команд в журнал и отчёт
+static void reportCommands(const std::vector<std::vector<std::string>> &commands,
+                           const std::vector<CommandResult> &results, const Config &config, Report &report) {
+    for (size_t i = 0; i < commands.size(); ++i) {
+        const CommandResult &result = results[i];
+        std::string line = commandLine(commands[i]);
+        if (!result.started) {
+            LOG_WARNING("Не удалось запустить " + line + ": " + result.error);
+        } else if (result.timedOut) {
+            LOG_WARNING("Команда прервана по таймауту (" + std::to_string(config.cliTimeout) + " с): " + line);
+        } else if (!result.succeeded()) {
+            LOG_WARNING("Команда завершилась с ошибкой (" +
+                        (result.exited ? "код " + std::to_string(result.exitCode)
+                                       : "сигнал " + std::to_string(result.signal)) + "): " + line);
+        } else {
+            LOG_INFO("Команда выполнена за " + std::to_string(static_cast<long long>(result.wallMs / 1000)) +
+                     " с: " + line);
+        }
+        // Вывод команды — в подробном журнале, а при ошибке — всегда
+        if (!result.output.empty() && (config.verbose || !result.succeeded())) {
+            std::istringstream lines(result.output);
+            std::string outputLine;
+            while (std::getline(lines, outputLine)) {
+                if (result.succeeded()) {
+                    LOG_DEBUG("    " + outputLine);
+                } else {
+                    LOG_WARNING("    " + outputLine);
+                }
+            }
+        }
 
-static bool runCommand(const std::string &cmd, const Config &config) {
-    if (config.dryRun) {
-        LOG_INFO("[Dry Run] Команда: " + cmd);
-        return true;
-    }
-    LOG_INFO("Команда: " + cmd);
-    int code = std::system(cmd.c_str());
-    if (code != 0) {
-        LOG_WARNING("Команда завершилась с ошибкой: " + cmd);
-        return false;
+        CommandReport entry;
+        entry.command = line;
+        entry.started = result.started;
+        entry.exited = result.exited;
+        entry.exitCode = result.exitCode;
+        entry.signal = result.signal;
+        entry.timedOut = result.timedOut;
+        entry.wallMs = result.wallMs;
+        entry.output = result.output;
+        entry.error = result.error;
+        report.addCommand(entry);
     }
-    return true;
 }
 
-static void runCliCleaners(const Config &config) {
+static void runCliCleaners(const Config &config, Report &report) {
+    PROFILE_SCOPE("runCliCleaners");
     if (!config.cliClean && !config.dockerPrune) return;
 
     LOG_INFO("CLI очистка:");
-    bool ranAny = false;
+    // Команды независимы: собираются списком и запускаются параллельно
+    std::vector<std::vector<std::string>> commands;
 
     if (config.cliClean) {
         if (commandExists("pip")) {
-            ranAny |= runCommand("pip cache purge", config);
+            commands.push_back({"pip", "cache", "purge"});
         } else {
             LOG_INFO("pip не найден");
         }
 
         if (commandExists("npm")) {
-            ranAny |= runCommand("npm cache clean --force", config);
+            commands.push_back({"npm", "cache", "clean", "--force"});
         } else {
             LOG_INFO("npm не найден");
         }
 
         if (commandExists("yarn")) {
-            ranAny |= runCommand("yarn cache clean", config);
+            commands.push_back({"yarn", "cache", "clean"});
         } else {
             LOG_INFO("yarn не найден");
         }
 
         if (commandExists("pnpm")) {
-            ranAny |= runCommand("pnpm store prune", config);
+            commands.push_back({"pnpm", "store", "prune"});
         } else {
             LOG_INFO("pnpm не найден");
         }
 
         if (commandExists("go")) {
-            ranAny |= runCommand("go clean -cache -testcache -modcache -fuzzcache", config);
+            commands.push_back({"go", "clean", "-cache", "-testcache", "-modcache", "-fuzzcache"});
         } else {
             LOG_INFO("go не найден");
         }
 
+        static const char *const kNugetLocals[] = {"http-cache", "global-packages", "temp", "plugins-cache"};
         if (commandExists("dotnet")) {
-            ranAny |= runCommand("dotnet nuget locals http-cache --clear", config);
-            ranAny |= runCommand("dotnet nuget locals global-packages --clear", config);
-            ranAny |= runCommand("dotnet nuget locals temp --clear", config);
-            ranAny |= runCommand("dotnet nuget locals plugins-cache --clear", config);
+            for (const char *local : kNugetLocals) commands.push_back({"dotnet", "nuget", "locals", local, "--clear"});
         } else if (commandExists("nuget")) {
-            ranAny |= runCommand("nuget locals http-cache -clear", config);
-            ranAny |= runCommand("nuget locals global-packages -clear", config);
-            ranAny |= runCommand("nuget locals temp -clear", config);
-            ranAny |= runCommand("nuget locals plugins-cache -clear", config);
+            for (const char *local : kNugetLocals) commands.push_back({"nuget", "locals", local, "-clear"});
         } else {
             LOG_INFO("dotnet/nuget не найден");
         }
@@ -163,24 +200,40 @@ static void runCliCleaners(const Config &config) {
 
     if (config.dockerPrune) {
         if (commandExists("docker")) {
-            std::string cmd = "docker system prune -f";
-            if (config.dockerPruneAll) cmd += " -a";
-            if (config.dockerPruneVolumes) cmd += " --volumes";
-            ranAny |= runCommand(cmd, config);
+            std::vector<std::string> cmd = {"docker", "system", "prune", "-f"};
+            if (config.dockerPruneAll) cmd.push_back("-a");
+            if (config.dockerPruneVolumes) cmd.push_back("--volumes");
+            commands.push_back(cmd);
         } else {
             LOG_INFO("docker не найден");
         }
     }
 
-    if (!ranAny) {
+    if (commands.empty()) {
         LOG_INFO("Нет доступных CLI команд для очистки");
+        return;
+    }
+    for (const auto &command : commands) {
+        LOG_INFO(std::string(config.dryRun ? "[Dry Run] Команда: " : "Команда: ") + commandLine(command));
     }
+    if (config.dryRun) return;
+
+    ProcessOptions options;
+    options.concurrency = config.cliJobs;
+    options.timeout = std::chrono::seconds(config.cliTimeout);
+    // Запускаем по путям, найденным при проверке: без повторного поиска по $PATH
+    auto resolved = commands;
+    for (auto &command : resolved) command[0] = findExecutable(command[0]);
+    reportCommands(commands, runCommands(resolved, options), config, report);
 }
 
 int main(int argc, char* argv[]) {
     std::cout << "KLEYNER Utility v1.0" << std::endl;
     printPixelArt("media/art.txt");
 
+    PhaseTimer configTimer;
+    // Окружение (переменные, WSL, домашняя папка Windows) снимается один раз на весь запуск
+    const EnvContext &env = environment();
     Config config = parseArguments(argc, argv);
     
     std::string configFile = config.configFile.empty() ? "configs/basic.cfg" : config.configFile;
@@ -190,8 +243,10 @@ int main(int argc, char* argv[]) {
     }
 
     if (!config.wslSet) {
-        config.wsl = isWSL();
+        config.wsl = env.wsl;
     }
+    // Режим наблюдения работает без терминала: повтор через sudo не предлагается
+    if (config.daemon) config.allowSudo = false;
     if (config.targetOS == OS_TYPE::AUTO) {
 #ifdef _WIN32
         config.targetOS = OS_TYPE::WINDOWS;
@@ -200,7 +255,15 @@ int main(int argc, char* argv[]) {
 #endif
     }
     
+    // Приоритеты задаются до запуска пулов потоков (новые потоки их наследуют);
+    // уже работающий поток журнала меняется вместе с остальными
+    std::string priorityError;
+    bool priorityOk = (config.niceLevel == 0 && !config.idleIo) ||
+                      setProcessPriority(config.niceLevel, config.idleIo, priorityError);
     initLogger(config.verbose);
+    if (!priorityOk) LOG_WARNING("Не удалось изменить приоритет: " + priorityError);
+    Report report(config.reportFormat, config.reportFile);
+    report.addPhase("config", configTimer);
     LOG_INFO("Запуск утилиты очистки");
 
     std::string mode;
@@ -210,30 +273,93 @@ int main(int argc, char* argv[]) {
     else mode = "Auto";
     LOG_INFO("Режим очистки: " + mode);
     if (config.wsl) LOG_INFO("Обнаружен WSL режим");
+
+    IO_BACKEND backend = setIoBackend(config.ioBackend);
+    if (backend != config.ioBackend && config.ioBackend == IO_BACKEND::URING) {
+        LOG_WARNING(std::string("Бэкенд ввода-вывода ") + ioBackendName(config.ioBackend) +
+                    " недоступен, используется " + ioBackendName(backend));
+    }
+    LOG_DEBUG(std::string("Бэкенд ввода-вывода: ") + ioBackendName(backend));
+    if (config.profile && !profile::available()) {
+        LOG_WARNING("--profile: профилирование не собрано, пересоберите с -DCLEANER_ENABLE_PROFILING=ON");
+    }
     
-    Cleaner cleaner(config);
+    if (config.purgeTrash) {
+        int code = purgeTrash(config);
+        LOG_INFO("Работа утилиты завершена");
+        return code;
+    }
+    // Деревья, оставшиеся в корзинах после сбоя, уже подтверждены к удалению
+    if (!config.dryRun && trashPending()) {
+        std::string error;
+        if (startTrashPurge(config, error)) {
+            LOG_INFO("В корзине остались деревья от прошлого запуска: запущено фоновое удаление");
+        } else {
+            LOG_WARNING("В корзине остались деревья от прошлого запуска, фоновое удаление не запущено: " + error);
+        }
+    }
+
+    PhaseTimer resolveTimer;
+    Cleaner cleaner(config, env);
+    report.addPhase("resolve", resolveTimer);
+
+    if (config.daemon) {
+        int code = runDaemon(config, cleaner);
+        LOG_INFO("Работа утилиты завершена");
+        return code;
+    }
 
+    PhaseTimer planTimer;
     cleaner.printPlan();
+    report.addPhase("plan", planTimer);
+    PhaseTimer countTimer;
     auto [numFiles, numDirs, totalSize] = cleaner.countItemsToDelete();
+    report.addPhase("count", countTimer);
 
     LOG_INFO("Будет удалено:");
     LOG_INFO("Файлов: " + std::to_string(numFiles));
     LOG_INFO("Папок: " + std::to_string(numDirs));
     LOG_INFO("Общий размер: " + std::to_string(totalSize) + " MB");
+    if (config.freeTarget > 0 || config.freeUntil > 0) {
+        LOG_INFO("Очистка до цели: из этого удаляются только давно не использованные файлы, пока цель не достигнута");
+    }
 
-    std::string confirmation;
-    std::cout << "Вы уверены, что хотите продолжить удаление? (y/n): ";
-    std::getline(std::cin, confirmation);
-    
-    if (confirmation == "y" || confirmation == "Y") {
+    bool confirmed = false;
+    if (!config.planOnly) {
+        std::string confirmation;
+        flushLogger();
+        std::cout << "Вы уверены, что хотите продолжить удаление? (y/n): ";
+        std::getline(std::cin, confirmation);
+        confirmed = confirmation == "y" || confirmation == "Y";
+    }
+    if (confirmed) {
+        PhaseTimer deleteTimer;
         cleaner.run();
-        runCliCleaners(config);
+        report.addPhase("delete", deleteTimer);
+        PhaseTimer cliTimer;
+        runCliCleaners(config, report);
+        report.addPhase("cli", cliTimer);
+        PhaseTimer pythonTimer;
         handlePythonEnvironments(config);
+        report.addPhase("python_envs", pythonTimer);
         LOG_INFO("Очистка завершена.");
+    } else if (config.planOnly) {
+        LOG_INFO("Только план (--plan): удаление не выполняется.");
     } else {
         LOG_INFO("Очистка отменена пользователем.");
     }
 
+    if (report.isOpen()) {
+        cleaner.writeReport(report);
+        RunSummary summary = cleaner.summary();
+        summary.confirmed = confirmed;
+        summary.peakMemory = peakMemoryBytes();
+        report.finish(summary);
+    }
+
+    if (config.profile) profile::printTable();
+
+    if (std::uint64_t peak = peakMemoryBytes()) LOG_INFO("Пиковая память: " + formatSize(peak));
     LOG_INFO("Работа утилиты завершена");
     return 0;
 }
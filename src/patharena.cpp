@@ -0,0 +1,26 @@
+#include "patharena.h"
+
+#include <cstring>
+
+std::string_view PathArena::store(std::string_view text) {
+    if (text.empty()) return std::string_view();
+    if (text.size() > left) {
+        // Длинная строка получает свой блок, текущий блок продолжает заполняться
+        bool own = text.size() > nextBlock / 4;
+        size_t size = own ? text.size() : nextBlock;
+        blocks.push_back(std::make_unique<char[]>(size));
+        allocated += size;
+        if (own) {
+            std::memcpy(blocks.back().get(), text.data(), text.size());
+            return std::string_view(blocks.back().get(), text.size());
+        }
+        cursor = blocks.back().get();
+        left = size;
+        if (nextBlock < kBlockSize) nextBlock *= 2;
+    }
+    char *out = cursor;
+    std::memcpy(out, text.data(), text.size());
+    cursor += text.size();
+    left -= text.size();
+    return std::string_view(out, text.size());
+}
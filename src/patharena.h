@@ -0,0 +1,40 @@
+#ifndef PATHARENA_H
+#define PATHARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+/// Хранилище строк с выделением «подряд» (bump allocator): строки копируются в
+/// блоки (первый — 1 КБ, каждый следующий вдвое больше, до 64 КБ) и живут, пока
+/// живёт хранилище. Корень с парой имён не держит целый большой блок. Одно выделение на блок вместо
+/// одного на строку, без заголовков и выравнивания std::string. Возвращённые
+/// string_view остаются действительными при перемещении хранилища.
+/// Не потокобезопасно: при обходе в несколько потоков запись идёт под блокировкой.
+class PathArena {
+public:
+    PathArena() = default;
+    PathArena(PathArena &&) noexcept = default;
+    PathArena &operator=(PathArena &&) noexcept = default;
+    PathArena(const PathArena &) = delete;
+    PathArena &operator=(const PathArena &) = delete;
+
+    /// Скопировать строку в хранилище
+    std::string_view store(std::string_view text);
+
+    /// Занято блоками (для учёта памяти)
+    size_t capacity() const { return allocated; }
+
+private:
+    static constexpr size_t kFirstBlock = 1024;
+    static constexpr size_t kBlockSize = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char *cursor = nullptr;
+    size_t left = 0;
+    size_t allocated = 0;
+    size_t nextBlock = kFirstBlock;
+};
+
+#endif // PATHARENA_H
@@ -0,0 +1,125 @@
+#include "pathlookup.h"
+#include "profile.h"
+#include "utils.h"
+
+#include <filesystem>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+#ifdef _WIN32
+constexpr char kPathSeparator = ';';
+#else
+constexpr char kPathSeparator = ':';
+#endif
+
+/// Директории $PATH в порядке поиска, без повторов
+std::vector<std::string> searchDirectories() {
+    std::vector<std::string> dirs;
+    const auto &vars = environment().vars;
+    auto it = vars.find("PATH");
+    if (it == vars.end()) return dirs;
+    const std::string &path = it->second;
+    size_t start = 0;
+    while (start <= path.size()) {
+        size_t end = path.find(kPathSeparator, start);
+        if (end == std::string::npos) end = path.size();
+        // Пустой элемент в POSIX означает текущую директорию
+        std::string dir = end > start ? path.substr(start, end - start) : std::string(".");
+        bool seen = false;
+        for (const auto &d : dirs) seen = seen || d == dir;
+        if (!seen) dirs.push_back(std::move(dir));
+        start = end + 1;
+    }
+    return dirs;
+}
+
+#ifdef _WIN32
+/// Расширения исполняемых файлов из %PATHEXT%
+std::vector<std::string> executableExtensions() {
+    std::vector<std::string> exts;
+    const auto &vars = environment().vars;
+    auto it = vars.find("PATHEXT");
+    std::string list = it != vars.end() ? it->second : ".COM;.EXE;.BAT;.CMD";
+    size_t start = 0;
+    while (start < list.size()) {
+        size_t end = list.find(';', start);
+        if (end == std::string::npos) end = list.size();
+        if (end > start) exts.push_back(list.substr(start, end - start));
+        start = end + 1;
+    }
+    return exts;
+}
+#endif
+
+/// Обычный файл, который текущий пользователь может запустить
+bool isExecutable(const std::string &path) {
+#ifdef _WIN32
+    std::error_code ec;
+    return fs::is_regular_file(path, ec);
+#else
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode) && ::access(path.c_str(), X_OK) == 0;
+#endif
+}
+
+std::string absolute(const std::string &path) {
+    std::error_code ec;
+    fs::path result = fs::absolute(path, ec);
+    return ec ? path : result.lexically_normal().string();
+}
+
+std::string resolve(const std::string &name) {
+#ifdef _WIN32
+    static const std::vector<std::string> exts = executableExtensions();
+    auto tryCandidate = [](const std::string &base) -> std::string {
+        if (fs::path(base).has_extension() && isExecutable(base)) return base;
+        for (const auto &ext : exts) {
+            if (isExecutable(base + ext)) return base + ext;
+        }
+        return {};
+    };
+    bool hasSeparator = name.find_first_of("/\\") != std::string::npos;
+#else
+    auto tryCandidate = [](const std::string &base) -> std::string {
+        return isExecutable(base) ? base : std::string();
+    };
+    bool hasSeparator = name.find('/') != std::string::npos;
+#endif
+    if (name.empty()) return {};
+    if (hasSeparator) {
+        std::string found = tryCandidate(name);
+        return found.empty() ? found : absolute(found);
+    }
+    static const std::vector<std::string> dirs = searchDirectories();
+    for (const auto &dir : dirs) {
+        std::string found = tryCandidate((fs::path(dir) / name).string());
+        if (!found.empty()) return absolute(found);
+    }
+    return {};
+}
+
+} // namespace
+
+std::string findExecutable(const std::string &name) {
+    PROFILE_SCOPE("findExecutable");
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::string> cache;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = cache.find(name);
+    if (it == cache.end()) it = cache.emplace(name, resolve(name)).first;
+    return it->second;
+}
+
+bool commandExists(const std::string &name) {
+    return !findExecutable(name).empty();
+}
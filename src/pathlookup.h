@@ -0,0 +1,15 @@
+#ifndef PATHLOOKUP_H
+#define PATHLOOKUP_H
+
+#include <string>
+
+/// Поиск исполняемого файла по $PATH без запуска оболочки. $PATH разбирается один
+/// раз, результат для каждого имени (в том числе «не найден») запоминается на всё
+/// время работы процесса. Имя с разделителем пути проверяется как есть.
+/// Возвращает абсолютный путь или пустую строку. Потокобезопасно.
+std::string findExecutable(const std::string &name);
+
+/// Есть ли команда в $PATH (аналог `command -v`)
+bool commandExists(const std::string &name);
+
+#endif // PATHLOOKUP_H
@@ -0,0 +1,342 @@
+#include "process.h"
+#include "profile.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <mutex>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+extern char **environ;
+#endif
+
+std::string commandLine(const std::vector<std::string> &argv) {
+    std::string line;
+    for (const auto &arg : argv) {
+        if (!line.empty()) line.push_back(' ');
+        line += arg;
+    }
+    return line;
+}
+
+#ifndef _WIN32
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// Запущенная команда
+struct Running {
+    size_t index;
+    pid_t pid;
+    int fd;                     // Чтение stdout/stderr; -1 после конца вывода
+    Clock::time_point started;
+    Clock::time_point deadline;     // Таймаут или (после SIGTERM) момент SIGKILL
+    bool terminating = false;
+    bool killed = false;
+};
+
+void appendOutput(CommandResult &result, const char *data, size_t size, size_t limit) {
+    result.output.append(data, size);
+    if (result.output.size() <= limit) return;
+    // Хвост начинается с целого символа UTF-8
+    size_t cut = result.output.size() - limit;
+    while (cut < result.output.size() && (static_cast<unsigned char>(result.output[cut]) & 0xC0) == 0x80) cut++;
+    result.output.erase(0, cut);
+}
+
+bool spawn(const std::vector<std::string> &argv, Running &running, CommandResult &result) {
+    if (argv.empty()) {
+        result.error = "пустая команда";
+        return false;
+    }
+    int pipes[2];
+    if (::pipe(pipes) != 0) {
+        result.error = std::strerror(errno);
+        return false;
+    }
+    ::fcntl(pipes[0], F_SETFD, FD_CLOEXEC);
+    ::fcntl(pipes[1], F_SETFD, FD_CLOEXEC);
+    ::fcntl(pipes[0], F_SETFL, O_NONBLOCK);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, pipes[1], 1);
+    posix_spawn_file_actions_adddup2(&actions, pipes[1], 2);
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    // Своя группа процессов: по таймауту завершаются и порождённые командой процессы
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attr, 0);
+
+    std::vector<char *> args;
+    for (const auto &arg : argv) args.push_back(const_cast<char *>(arg.c_str()));
+    args.push_back(nullptr);
+    pid_t pid = 0;
+    int rc = posix_spawnp(&pid, args[0], &actions, &attr, args.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    ::close(pipes[1]);
+    if (rc != 0) {
+        ::close(pipes[0]);
+        result.error = rc == ENOENT ? "команда не найдена" : std::strerror(rc);
+        return false;
+    }
+    running.pid = pid;
+    running.fd = pipes[0];
+    result.started = true;
+    return true;
+}
+
+void drainOutput(Running &running, CommandResult &result, size_t limit) {
+    char buffer[16 * 1024];
+    for (;;) {
+        ssize_t n = ::read(running.fd, buffer, sizeof(buffer));
+        if (n > 0) {
+            appendOutput(result, buffer, static_cast<size_t>(n), limit);
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) return;
+        ::close(running.fd);
+        running.fd = -1;
+        return;
+    }
+}
+
+} // namespace
+
+std::vector<CommandResult> runCommands(const std::vector<std::vector<std::string>> &commands,
+                                       const ProcessOptions &options) {
+    PROFILE_SCOPE("runCommands");
+    std::vector<CommandResult> results(commands.size());
+    std::vector<Running> running;
+    size_t concurrency = std::max(1u, options.concurrency);
+    size_t next = 0;
+    while (next < commands.size() || !running.empty()) {
+        while (running.size() < concurrency && next < commands.size()) {
+            Running item{next, 0, -1, Clock::now(), Clock::time_point::max()};
+            if (spawn(commands[next], item, results[next])) {
+                if (options.timeout.count() > 0) item.deadline = item.started + options.timeout;
+                running.push_back(item);
+            }
+            next++;
+        }
+        if (running.empty()) continue;
+
+        auto now = Clock::now();
+        auto wake = now + std::chrono::milliseconds(100);
+        std::vector<struct pollfd> fds;
+        for (const auto &item : running) {
+            wake = std::min(wake, item.deadline);
+            if (item.fd >= 0) fds.push_back({item.fd, POLLIN, 0});
+        }
+        // Завершение процессов проверяется не реже раза в 100 мс
+        auto waitMs = std::chrono::duration_cast<std::chrono::milliseconds>(wake - now).count();
+        ::poll(fds.data(), fds.size(), static_cast<int>(std::max<long long>(waitMs, 0)));
+
+        now = Clock::now();
+        for (auto it = running.begin(); it != running.end();) {
+            CommandResult &result = results[it->index];
+            if (it->fd >= 0) drainOutput(*it, result, options.outputLimit);
+            int status = 0;
+            if (::waitpid(it->pid, &status, WNOHANG) == it->pid) {
+                // Вывод мог унаследовать оставшийся работать потомок: не ждём его
+                if (it->fd >= 0) {
+                    drainOutput(*it, result, options.outputLimit);
+                    if (it->fd >= 0) ::close(it->fd);
+                }
+                result.wallMs = std::chrono::duration<double, std::milli>(Clock::now() - it->started).count();
+                if (WIFEXITED(status)) {
+                    result.exited = true;
+                    result.exitCode = WEXITSTATUS(status);
+                } else if (WIFSIGNALED(status)) {
+                    result.signal = WTERMSIG(status);
+                }
+                it = running.erase(it);
+                continue;
+            }
+            if (now >= it->deadline && !it->killed) {
+                if (!it->terminating) {
+                    result.timedOut = true;
+                    it->terminating = true;
+                    ::kill(-it->pid, SIGTERM);
+                    it->deadline = now + options.killGrace;
+                } else {
+                    ::kill(-it->pid, SIGKILL);
+                    it->killed = true;
+                    it->deadline = Clock::time_point::max();
+                }
+            }
+            ++it;
+        }
+    }
+    return results;
+}
+
+int spawnDetached(const std::vector<std::string> &argv, const std::string &outputPath, std::string &error) {
+    // Отсоединённые процессы после завершения подбираются здесь, без обработчика SIGCHLD
+    static std::mutex mutex;
+    static std::vector<pid_t> children;
+    std::lock_guard<std::mutex> lock(mutex);
+    children.erase(std::remove_if(children.begin(), children.end(), [](pid_t pid) {
+        return ::waitpid(pid, nullptr, WNOHANG) != 0;
+    }), children.end());
+
+    if (argv.empty()) {
+        error = "пустая команда";
+        return -1;
+    }
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, 1, outputPath.empty() ? "/dev/null" : outputPath.c_str(),
+                                     O_WRONLY | O_CREAT | O_APPEND, 0600);
+    posix_spawn_file_actions_adddup2(&actions, 1, 2);
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    // Своя сессия: процесс не получает сигналы терминала и переживает родителя
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID);
+
+    std::vector<char *> args;
+    for (const auto &arg : argv) args.push_back(const_cast<char *>(arg.c_str()));
+    args.push_back(nullptr);
+    pid_t pid = 0;
+    int rc = posix_spawn(&pid, args[0], &actions, &attr, args.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    if (rc != 0) {
+        error = std::strerror(rc);
+        return -1;
+    }
+    children.push_back(pid);
+    return pid;
+}
+
+std::string selfExecutable() {
+#ifdef __linux__
+    char buffer[4096];
+    ssize_t n = ::readlink("/proc/self/exe", buffer, sizeof(buffer));
+    if (n > 0 && static_cast<size_t>(n) < sizeof(buffer)) return std::string(buffer, static_cast<size_t>(n));
+#endif
+    return std::string();
+}
+
+namespace {
+
+/// Потоки процесса: на Linux nice и класс ввода-вывода действуют на отдельный поток,
+/// поэтому меняются у всех уже запущенных (например, потока записи журнала).
+/// 0 — сам процесс (вызывающий поток), если список потоков недоступен.
+std::vector<int> processThreads() {
+    std::vector<int> threads;
+#ifdef __linux__
+    if (DIR *dir = ::opendir("/proc/self/task")) {
+        while (struct dirent *entry = ::readdir(dir)) {
+            if (entry->d_name[0] != '.') threads.push_back(std::atoi(entry->d_name));
+        }
+        ::closedir(dir);
+    }
+#endif
+    if (threads.empty()) threads.push_back(0);
+    return threads;
+}
+
+} // namespace
+
+bool setProcessPriority(int niceness, bool idleIo, std::string &error) {
+    bool ok = true;
+    std::vector<int> threads = processThreads();
+    if (niceness != 0) {
+        for (int tid : threads) {
+            if (::setpriority(PRIO_PROCESS, static_cast<id_t>(tid), niceness) != 0 && errno != ESRCH) {
+                error = std::string("nice: ") + std::strerror(errno);
+                ok = false;
+                break;
+            }
+        }
+    }
+    if (idleIo) {
+#if defined(__linux__) && defined(SYS_ioprio_set)
+        // ioprio_set(IOPRIO_WHO_PROCESS, tid, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT)
+        constexpr int kWhoProcess = 1;
+        constexpr int kClassIdle = 3;
+        constexpr int kClassShift = 13;
+        for (int tid : threads) {
+            if (::syscall(SYS_ioprio_set, kWhoProcess, tid, kClassIdle << kClassShift) != 0 && errno != ESRCH) {
+                error = std::string("ioprio_set: ") + std::strerror(errno);
+                ok = false;
+                break;
+            }
+        }
+#else
+        error = "класс ввода-вывода idle не поддерживается";
+        ok = false;
+#endif
+    }
+    return ok;
+}
+
+std::uint64_t peakMemoryBytes() {
+    struct rusage usage;
+    if (::getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return static_cast<std::uint64_t>(usage.ru_maxrss);            // В байтах
+#else
+    return static_cast<std::uint64_t>(usage.ru_maxrss) * 1024;     // В килобайтах
+#endif
+}
+
+#else
+
+int spawnDetached(const std::vector<std::string> &argv, const std::string &outputPath, std::string &error) {
+    (void)argv;
+    (void)outputPath;
+    error = "не поддерживается";
+    return -1;
+}
+
+std::string selfExecutable() {
+    return std::string();
+}
+
+bool setProcessPriority(int niceness, bool idleIo, std::string &error) {
+    if (niceness == 0 && !idleIo) return true;
+    error = "не поддерживается";
+    return false;
+}
+
+std::uint64_t peakMemoryBytes() {
+    return 0;
+}
+
+std::vector<CommandResult> runCommands(const std::vector<std::vector<std::string>> &commands,
+                                       const ProcessOptions &options) {
+    // Без posix_spawn: по очереди через оболочку, без таймаута и без захвата вывода
+    (void)options;
+    std::vector<CommandResult> results(commands.size());
+    for (size_t i = 0; i < commands.size(); ++i) {
+        auto started = std::chrono::steady_clock::now();
+        int code = std::system(commandLine(commands[i]).c_str());
+        results[i].started = true;
+        results[i].exited = true;
+        results[i].exitCode = code;
+        results[i].wallMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - started).count();
+    }
+    return results;
+}
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef PROCESS_H
+#define PROCESS_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Параметры запуска внешних команд
+struct ProcessOptions {
+    unsigned concurrency = 4;               // Одновременно запущенных команд (0 — 1)
+    std::chrono::seconds timeout{0};        // Предел на команду (0 — без предела)
+    std::chrono::seconds killGrace{5};      // После SIGTERM по таймауту — до SIGKILL
+    size_t outputLimit = 64 * 1024;         // Сколько последних байт вывода хранить
+};
+
+/// Результат одной команды
+struct CommandResult {
+    bool started = false;       // false — не удалось запустить (см. error)
+    bool exited = false;        // Завершилась сама, exitCode — её код возврата
+    int exitCode = -1;
+    int signal = 0;             // Сигнал, которым завершён процесс (0 — нет)
+    bool timedOut = false;      // Прервана по таймауту
+    double wallMs = 0;
+    std::string output;         // Хвост stdout и stderr (вперемешку, как в терминале)
+    std::string error;          // Ошибка запуска (например, команда не найдена)
+
+    bool succeeded() const { return exited && exitCode == 0; }
+};
+
+/// Команда для журнала: аргументы через пробел
+std::string commandLine(const std::vector<std::string> &argv);
+
+/// Параллельный запуск команд без промежуточной оболочки (posix_spawnp): stdin —
+/// /dev/null, stdout и stderr собираются в CommandResult::output. Каждая команда —
+/// в своей группе процессов, по таймауту группа получает SIGTERM, затем SIGKILL,
+/// так что зависшая команда не задерживает остальные дольше своего предела.
+/// Результаты — в порядке команд.
+std::vector<CommandResult> runCommands(const std::vector<std::vector<std::string>> &commands,
+                                       const ProcessOptions &options);
+
+/// Запуск отсоединённого процесса (своя сессия, stdin — /dev/null, stdout и stderr
+/// дописываются в outputPath). Не ждёт завершения; возвращает pid или -1 с ошибкой
+/// в error. Завершившиеся процессы подбираются при следующих вызовах.
+/// На Windows не поддерживается.
+int spawnDetached(const std::vector<std::string> &argv, const std::string &outputPath, std::string &error);
+
+/// Путь к исполняемому файлу текущего процесса (пусто — неизвестен)
+std::string selfExecutable();
+
+/// Приоритет текущего процесса: niceness (0 — не менять) и класс ввода-вывода idle
+/// (ioprio_set, только Linux; диск достаётся процессу, когда он простаивает).
+/// На Linux оба действуют на отдельные потоки: меняются у всех уже запущенных
+/// потоков процесса, созданные позже их наследуют. false — что-то не применилось
+/// (причина в error).
+bool setProcessPriority(int niceness, bool idleIo, std::string &error);
+
+/// Пиковый размер резидентной памяти процесса в байтах (0 — неизвестен)
+std::uint64_t peakMemoryBytes();
+
+#endif // PROCESS_H
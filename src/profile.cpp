@@ -0,0 +1,206 @@
+#include "profile.h"
+#include "logger.h"
+
+#ifdef CLEANER_PROFILING
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace profile {
+
+namespace {
+
+const char *const kCounterNames[CounterCount] = {
+    "open", "readdir", "stat", "unlink", "rmdir", "uring submit", "entries", "bytes freed"
+};
+
+std::uint64_t nowNanos() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/// Удаление в группе: элементы, байты, время первого и последнего результата
+struct GroupStats {
+    std::atomic<std::uint64_t> entries{0};
+    std::atomic<std::uint64_t> bytes{0};
+    std::atomic<std::uint64_t> first{UINT64_MAX};
+    std::atomic<std::uint64_t> last{0};
+};
+
+struct LocalCounters;
+
+struct Registry {
+    std::mutex mutex;
+    std::uint64_t retired[CounterCount] = {0};
+    std::vector<LocalCounters *> live;
+    std::deque<TimerSlot> timers;      // deque: адреса слотов не меняются
+    std::vector<std::string> groupNames;
+    std::unique_ptr<GroupStats[]> groups;
+    std::uint64_t startNanos = nowNanos();
+};
+
+Registry &registry() {
+    static Registry instance;
+    return instance;
+}
+
+/// Счётчики одного потока: пишет только владелец (без lock-префикса),
+/// при завершении потока значения переносятся в общие итоги
+struct LocalCounters {
+    std::atomic<std::uint64_t> values[CounterCount];
+
+    LocalCounters() {
+        for (auto &value : values) value.store(0, std::memory_order_relaxed);
+        Registry &reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.live.push_back(this);
+    }
+
+    ~LocalCounters() {
+        Registry &reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        for (int i = 0; i < CounterCount; ++i) reg.retired[i] += values[i].load(std::memory_order_relaxed);
+        reg.live.erase(std::find(reg.live.begin(), reg.live.end(), this));
+    }
+};
+
+/// Сумма счётчиков по живым и завершившимся потокам
+void collect(std::uint64_t totals[CounterCount]) {
+    Registry &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (int i = 0; i < CounterCount; ++i) totals[i] = reg.retired[i];
+    for (const LocalCounters *local : reg.live) {
+        for (int i = 0; i < CounterCount; ++i) totals[i] += local->values[i].load(std::memory_order_relaxed);
+    }
+}
+
+} // namespace
+
+void add(Counter counter, std::uint64_t n) {
+    thread_local LocalCounters local;
+    std::atomic<std::uint64_t> &value = local.values[counter];
+    value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+std::uint64_t total(Counter counter) {
+    std::uint64_t totals[CounterCount];
+    collect(totals);
+    return totals[counter];
+}
+
+void groupResult(size_t group, std::uint64_t bytes) {
+    Registry &reg = registry();
+    if (!reg.groups || group >= reg.groupNames.size()) return;
+    GroupStats &stats = reg.groups[group];
+    std::uint64_t now = nowNanos();
+    stats.entries.fetch_add(1, std::memory_order_relaxed);
+    stats.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    std::uint64_t seen = stats.first.load(std::memory_order_relaxed);
+    while (now < seen && !stats.first.compare_exchange_weak(seen, now, std::memory_order_relaxed)) {}
+    seen = stats.last.load(std::memory_order_relaxed);
+    while (now > seen && !stats.last.compare_exchange_weak(seen, now, std::memory_order_relaxed)) {}
+}
+
+TimerSlot &timerSlot(const char *name) {
+    Registry &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.timers.emplace_back();
+    reg.timers.back().name = name;
+    return reg.timers.back();
+}
+
+ScopedTimer::ScopedTimer(TimerSlot &slot) : slot(slot), start(nowNanos()) {}
+
+ScopedTimer::~ScopedTimer() {
+    slot.calls.fetch_add(1, std::memory_order_relaxed);
+    slot.nanos.fetch_add(nowNanos() - start, std::memory_order_relaxed);
+}
+
+bool available() {
+    return true;
+}
+
+void setGroups(const std::vector<std::string> &names) {
+    Registry &reg = registry();
+    reg.groupNames = names;
+    reg.groups.reset(new GroupStats[names.size()]);
+}
+
+static std::string format(const char *fmt, double a, double b = 0, double c = 0) {
+    char buffer[128];
+    std::snprintf(buffer, sizeof(buffer), fmt, a, b, c);
+    return buffer;
+}
+
+void printTable() {
+    Registry &reg = registry();
+    std::uint64_t totals[CounterCount];
+    collect(totals);
+    double elapsed = static_cast<double>(nowNanos() - reg.startNanos) / 1e9;
+
+    LOG_INFO("Профиль:");
+    for (int i = 0; i < CounterCount; ++i) {
+        LOG_INFO(std::string("  ") + kCounterNames[i] + ": " + std::to_string(totals[i]));
+    }
+    std::uint64_t syscalls = totals[Open] + totals[Readdir] + totals[Stat] + totals[Unlink] + totals[Rmdir];
+    if (totals[Entries] > 0) {
+        LOG_INFO(format("  вызовов на элемент: %.2f", static_cast<double>(syscalls) / totals[Entries]));
+    }
+    if (elapsed > 0) {
+        LOG_INFO(format("  элементов/с: %.0f, освобождено МБ/с: %.2f", totals[Entries] / elapsed,
+                        totals[BytesFreed] / elapsed / (1024 * 1024)));
+    }
+
+    LOG_INFO("  Время по методам (вызовов, всего мс):");
+    std::vector<const TimerSlot *> timers;
+    {
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        for (const auto &slot : reg.timers) timers.push_back(&slot);
+    }
+    std::stable_sort(timers.begin(), timers.end(), [](const TimerSlot *a, const TimerSlot *b) {
+        return a->nanos.load() > b->nanos.load();
+    });
+    for (const TimerSlot *slot : timers) {
+        LOG_INFO(std::string("    ") + slot->name + ": " + std::to_string(slot->calls.load()) +
+                 format(", %.3f мс", slot->nanos.load() / 1e6));
+    }
+
+    bool header = false;
+    for (size_t i = 0; i < reg.groupNames.size(); ++i) {
+        const GroupStats &stats = reg.groups[i];
+        std::uint64_t entries = stats.entries.load();
+        if (entries == 0) continue;
+        if (!header) {
+            LOG_INFO("  Удаление по группам (элементов, элементов/с, МБ/с):");
+            header = true;
+        }
+        double seconds = static_cast<double>(stats.last.load() - stats.first.load()) / 1e9;
+        double bytes = static_cast<double>(stats.bytes.load());
+        std::string rates = seconds > 0
+            ? format(", %.0f/с, %.2f МБ/с", entries / seconds, bytes / seconds / (1024 * 1024))
+            : std::string(", мгновенно");
+        LOG_INFO("    " + reg.groupNames[i] + ": " + std::to_string(entries) + rates);
+    }
+}
+
+} // namespace profile
+
+#else
+
+namespace profile {
+
+bool available() {
+    return false;
+}
+
+void setGroups(const std::vector<std::string> &) {}
+
+void printTable() {}
+
+} // namespace profile
+
+#endif // CLEANER_PROFILING
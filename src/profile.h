@@ -0,0 +1,86 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Счётчики горячих путей и таймеры методов для --profile. Собираются только
+// с -DCLEANER_ENABLE_PROFILING=ON; без него макросы PROFILE_* пусты и в коде
+// не остаётся ни счётчиков, ни замеров времени.
+#ifdef CLEANER_ENABLE_PROFILING
+#define CLEANER_PROFILING 1
+#endif
+
+namespace profile {
+
+/// Учитываемые операции
+enum Counter {
+    Open,           // open/openat директорий
+    Readdir,        // Вызовы getdents64 (или шаги directory_iterator)
+    Stat,           // fstatat/stat/statx
+    Unlink,
+    Rmdir,
+    UringSubmit,    // Пакеты, отправленные в io_uring
+    Entries,        // Элементы, встреченные при обходе
+    BytesFreed,
+    CounterCount
+};
+
+/// Профилирование собрано в программу
+bool available();
+
+/// Имена групп целей для построчной статистики (индекс — номер группы)
+void setGroups(const std::vector<std::string> &names);
+
+/// Вывод таблицы через журнал
+void printTable();
+
+#ifdef CLEANER_PROFILING
+
+void add(Counter counter, std::uint64_t n);
+
+/// Текущее значение счётчика по всем потокам (для замеров разницы до и после)
+std::uint64_t total(Counter counter);
+
+/// Результат удаления элемента группы: число, байты и время первого/последнего
+void groupResult(size_t group, std::uint64_t bytes);
+
+/// Накопитель времени одного места замера
+struct TimerSlot {
+    const char *name;
+    std::atomic<std::uint64_t> calls{0};
+    std::atomic<std::uint64_t> nanos{0};
+};
+
+TimerSlot &timerSlot(const char *name);
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(TimerSlot &slot);
+    ~ScopedTimer();
+
+private:
+    TimerSlot &slot;
+    std::uint64_t start;
+};
+
+#endif // CLEANER_PROFILING
+
+} // namespace profile
+
+#ifdef CLEANER_PROFILING
+#define PROFILE_COUNT(counter, n) ::profile::add(::profile::counter, (n))
+#define PROFILE_GROUP(group, bytes) ::profile::groupResult((group), (bytes))
+#define PROFILE_SCOPE(name)                                                     \
+    static ::profile::TimerSlot &profileSlot_ = ::profile::timerSlot(name);     \
+    ::profile::ScopedTimer profileTimer_(profileSlot_)
+#else
+#define PROFILE_COUNT(counter, n) ((void)0)
+#define PROFILE_GROUP(group, bytes) ((void)0)
+#define PROFILE_SCOPE(name) ((void)0)
+#endif
+
+#endif // PROFILE_H
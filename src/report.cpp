@@ -0,0 +1,301 @@
+#include "report.h"
+#include "logger.h"
+
+#include <cstdio>
+#include <iostream>
+
+static const std::uint64_t kReportVersion = 1;
+
+void JsonWriter::separate() {
+    if (afterKey) {
+        afterKey = false;
+        return;
+    }
+    if (first.empty()) return;
+    if (!first.back()) out << ',';
+    first.back() = false;
+}
+
+void JsonWriter::beginObject() {
+    separate();
+    out << '{';
+    first.push_back(true);
+}
+
+void JsonWriter::endObject() {
+    first.pop_back();
+    out << '}';
+}
+
+void JsonWriter::beginArray() {
+    separate();
+    out << '[';
+    first.push_back(true);
+}
+
+void JsonWriter::endArray() {
+    first.pop_back();
+    out << ']';
+}
+
+void JsonWriter::key(const std::string &name) {
+    value(name);
+    out << ':';
+    afterKey = true;
+}
+
+void JsonWriter::value(std::string_view text) {
+    separate();
+    out << '"';
+    for (unsigned char c : text) {
+        switch (c) {
+        case '"': out << "\\\""; break;
+        case '\\': out << "\\\\"; break;
+        case '\n': out << "\\n"; break;
+        case '\r': out << "\\r"; break;
+        case '\t': out << "\\t"; break;
+        default:
+            if (c < 0x20) {
+                char buffer[8];
+                std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                out << buffer;
+            } else {
+                out << static_cast<char>(c);   // UTF-8 пишется как есть
+            }
+        }
+    }
+    out << '"';
+}
+
+void JsonWriter::value(const char *text) {
+    value(std::string_view(text));
+}
+
+void JsonWriter::value(std::uint64_t number) {
+    separate();
+    out << number;
+}
+
+void JsonWriter::value(double number) {
+    separate();
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.3f", number);
+    out << buffer;
+}
+
+void JsonWriter::value(bool flag) {
+    separate();
+    out << (flag ? "true" : "false");
+}
+
+PhaseTimer::PhaseTimer()
+    : wallStart(std::chrono::steady_clock::now()),
+      cpuStart(std::clock()) {}
+
+double PhaseTimer::wallMs() const {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+}
+
+double PhaseTimer::cpuMs() const {
+    return 1000.0 * static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+}
+
+Report::Report(REPORT_FORMAT format, const std::string &path) : format(format) {
+    if (path.empty() || path == "-") {
+        out = &std::cout;
+        toStdout = true;
+    } else {
+        file.open(path, std::ios::out | std::ios::trunc);
+        if (file) {
+            out = &file;
+        } else {
+            LOG_ERROR("Не удалось открыть файл отчёта: " + path);
+        }
+    }
+}
+
+Report::~Report() {
+    if (out) out->flush();
+}
+
+bool Report::isOpen() const {
+    return out != nullptr && format != REPORT_FORMAT::NONE;
+}
+
+/// Перед записью в stdout дожидаемся журнала, чтобы строки не перемешивались
+void Report::prepare() {
+    if (toStdout) flushLogger();
+    if (format != REPORT_FORMAT::JSON || started) return;
+    started = true;
+    json = std::make_unique<JsonWriter>(*out);
+    json->beginObject();
+    json->field("version", kReportVersion);
+    json->key("groups");
+    json->beginArray();
+}
+
+void Report::endLine() {
+    *out << '\n';
+    if (toStdout) out->flush();
+}
+
+void Report::writePhase(JsonWriter &writer, const Phase &phase) {
+    writer.field("name", phase.name);
+    writer.field("wall_ms", phase.wallMs);
+    writer.field("cpu_ms", phase.cpuMs);
+}
+
+void Report::writeCommand(JsonWriter &writer, const CommandReport &command) {
+    writer.field("command", command.command);
+    writer.field("started", command.started);
+    if (command.exited) writer.field("exit_code", static_cast<std::uint64_t>(command.exitCode));
+    if (command.signal != 0) writer.field("signal", static_cast<std::uint64_t>(command.signal));
+    writer.field("timed_out", command.timedOut);
+    writer.field("wall_ms", command.wallMs);
+    if (!command.output.empty()) writer.field("output", command.output);
+    if (!command.error.empty()) writer.field("error", command.error);
+}
+
+void Report::writeGroupTotals(JsonWriter &writer, const GroupReport &group) {
+    writer.field("bytes", group.bytes);
+    writer.field("files", group.files);
+    writer.field("dirs", group.dirs);
+    writer.field("denied", group.denied);
+    writer.field("errors", group.errors);
+}
+
+void Report::writePath(JsonWriter &writer, const PathReport &path) {
+    writer.field("path", path.path);
+    writer.field("exists", path.exists);
+    writer.field("bytes", path.bytes);
+    writer.field("files", path.files);
+    writer.field("dirs", path.dirs);
+    writer.field("denied", path.denied);
+    writer.field("errors", path.errors);
+    if (!path.error.empty()) writer.field("error", path.error);
+}
+
+void Report::addPhase(const std::string &name, const PhaseTimer &timer) {
+    if (!isOpen() || finished) return;
+    Phase phase{name, timer.wallMs(), timer.cpuMs()};
+    if (format == REPORT_FORMAT::JSON) {
+        phases.push_back(phase);
+        return;
+    }
+    prepare();
+    JsonWriter writer(*out);
+    writer.beginObject();
+    writer.field("type", "phase");
+    writePhase(writer, phase);
+    writer.endObject();
+    endLine();
+}
+
+void Report::beginGroup(const GroupReport &group) {
+    if (!isOpen() || finished || format != REPORT_FORMAT::JSON) return;
+    prepare();
+    json->beginObject();
+    json->field("scope", group.scope);
+    json->field("name", group.name);
+    json->field("pattern", group.pattern);
+    json->key("paths");
+    json->beginArray();
+}
+
+void Report::addPath(const GroupReport &group, const PathReport &path) {
+    if (!isOpen() || finished) return;
+    prepare();
+    if (format == REPORT_FORMAT::JSON) {
+        json->beginObject();
+        writePath(*json, path);
+        json->endObject();
+        return;
+    }
+    JsonWriter writer(*out);
+    writer.beginObject();
+    writer.field("type", "path");
+    writer.field("scope", group.scope);
+    writer.field("group", group.name);
+    writePath(writer, path);
+    writer.endObject();
+    endLine();
+}
+
+void Report::endGroup(const GroupReport &group) {
+    if (!isOpen() || finished) return;
+    prepare();
+    if (format == REPORT_FORMAT::JSON) {
+        json->endArray();
+        writeGroupTotals(*json, group);
+        json->endObject();
+        return;
+    }
+    JsonWriter writer(*out);
+    writer.beginObject();
+    writer.field("type", "group");
+    writer.field("scope", group.scope);
+    writer.field("name", group.name);
+    writer.field("pattern", group.pattern);
+    writeGroupTotals(writer, group);
+    writer.endObject();
+    endLine();
+}
+
+void Report::addCommand(const CommandReport &command) {
+    if (!isOpen() || finished) return;
+    if (format == REPORT_FORMAT::JSON) {
+        commands.push_back(command);
+        return;
+    }
+    prepare();
+    JsonWriter writer(*out);
+    writer.beginObject();
+    writer.field("type", "command");
+    writeCommand(writer, command);
+    writer.endObject();
+    endLine();
+}
+
+void Report::finish(const RunSummary &summary) {
+    if (!isOpen() || finished) return;
+    prepare();
+    JsonWriter lineWriter(*out);
+    JsonWriter &writer = format == REPORT_FORMAT::JSON ? *json : lineWriter;
+    if (format == REPORT_FORMAT::JSON) {
+        json->endArray();
+        json->key("phases");
+        json->beginArray();
+        for (const auto &phase : phases) {
+            json->beginObject();
+            writePhase(*json, phase);
+            json->endObject();
+        }
+        json->endArray();
+        json->key("commands");
+        json->beginArray();
+        for (const auto &command : commands) {
+            json->beginObject();
+            writeCommand(*json, command);
+            json->endObject();
+        }
+        json->endArray();
+        json->key("summary");
+    }
+    writer.beginObject();
+    if (format == REPORT_FORMAT::NDJSON) writer.field("type", "summary");
+    writer.field("confirmed", summary.confirmed);
+    writer.field("dry_run", summary.dryRun);
+    writer.field("bytes", summary.bytes);
+    writer.field("files", summary.files);
+    writer.field("dirs", summary.dirs);
+    writer.field("removed_files", summary.removedFiles);
+    writer.field("removed_dirs", summary.removedDirs);
+    writer.field("freed_bytes", summary.freedBytes);
+    writer.field("failed", summary.failed);
+    writer.field("peak_rss_bytes", summary.peakMemory);
+    writer.endObject();
+    if (format == REPORT_FORMAT::JSON) json->endObject();
+    endLine();
+    out->flush();
+    finished = true;
+}
@@ -0,0 +1,156 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include "config.h"
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// Потоковая запись JSON без построения дерева в памяти
+class JsonWriter {
+public:
+    explicit JsonWriter(std::ostream &out) : out(out) {}
+
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+    void key(const std::string &name);
+    void value(std::string_view text);
+    void value(const char *text);
+    void value(std::uint64_t number);
+    void value(double number);
+    void value(bool flag);
+
+    template <typename T>
+    void field(const std::string &name, const T &v) {
+        key(name);
+        value(v);
+    }
+
+private:
+    std::ostream &out;
+    std::vector<bool> first;    // Для каждого открытого уровня: ещё не было элементов
+    bool afterKey = false;
+
+    void separate();
+};
+
+/// Замер фазы работы: настенное и процессорное время процесса (все потоки)
+class PhaseTimer {
+public:
+    PhaseTimer();
+    double wallMs() const;
+    double cpuMs() const;
+
+private:
+    std::chrono::steady_clock::time_point wallStart;
+    std::clock_t cpuStart;
+};
+
+/// Итоги одного пути цели
+struct PathReport {
+    std::string path;
+    bool exists = false;
+    bool denied = false;
+    std::uint64_t files = 0;
+    std::uint64_t dirs = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t errors = 0;   // Ошибка сканирования и неудавшиеся удаления внутри пути
+    std::string error;
+};
+
+/// Итоги группы целей
+struct GroupReport {
+    std::string scope;
+    std::string name;
+    std::string pattern;
+    std::uint64_t files = 0;
+    std::uint64_t dirs = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t denied = 0;
+    std::uint64_t errors = 0;
+};
+
+/// Итог внешней команды очистки (CLI)
+struct CommandReport {
+    std::string command;
+    bool started = false;
+    bool exited = false;        // Завершилась сама, exitCode — код возврата
+    int exitCode = 0;
+    int signal = 0;             // Сигнал, которым завершена (0 — нет)
+    bool timedOut = false;
+    double wallMs = 0;
+    std::string output;         // Хвост stdout и stderr
+    std::string error;          // Ошибка запуска
+};
+
+/// Итоги запуска
+struct RunSummary {
+    bool confirmed = false;
+    bool dryRun = false;
+    std::uint64_t files = 0;
+    std::uint64_t dirs = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t removedFiles = 0;
+    std::uint64_t removedDirs = 0;
+    std::uint64_t freedBytes = 0;
+    std::uint64_t failed = 0;
+    std::uint64_t peakMemory = 0;   // Пиковая резидентная память процесса, байт
+};
+
+/// Машиночитаемый отчёт о запуске (--report=json|ndjson).
+/// Пути и группы пишутся сразу по мере готовности: в NDJSON — отдельной строкой
+/// на запись, в JSON — внутри одного объекта, без накопления в памяти.
+class Report {
+public:
+    /// path "-" — стандартный вывод
+    Report(REPORT_FORMAT format, const std::string &path);
+    ~Report();
+
+    bool isOpen() const;
+
+    void addPhase(const std::string &name, const PhaseTimer &timer);
+
+    void beginGroup(const GroupReport &group);
+    void addPath(const GroupReport &group, const PathReport &path);
+    void endGroup(const GroupReport &group);
+
+    void addCommand(const CommandReport &command);
+
+    /// Итоги и время фаз; после вызова отчёт закрыт
+    void finish(const RunSummary &summary);
+
+private:
+    struct Phase {
+        std::string name;
+        double wallMs;
+        double cpuMs;
+    };
+
+    REPORT_FORMAT format;
+    std::ofstream file;
+    std::ostream *out = nullptr;
+    bool toStdout = false;
+    bool started = false;
+    bool finished = false;
+    std::vector<Phase> phases;   // Для JSON: пишутся в конце, их немного
+    std::vector<CommandReport> commands;
+    std::unique_ptr<JsonWriter> json;
+
+    void prepare();
+    void writePhase(JsonWriter &writer, const Phase &phase);
+    void writeGroupTotals(JsonWriter &writer, const GroupReport &group);
+    void writePath(JsonWriter &writer, const PathReport &path);
+    void writeCommand(JsonWriter &writer, const CommandReport &command);
+    void endLine();
+};
+
+#endif // REPORT_H
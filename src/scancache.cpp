@@ -0,0 +1,240 @@
+#include "scancache.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char kMagic[8] = {'K', 'L', 'N', 'S', 'C', 'A', 'N', '\0'};
+const std::uint32_t kVersion = 1;
+
+// Структуры файла: все поля выровнены по 8 байт, порядок байт — родной для машины
+struct FileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t recordSize;       // sizeof(DirRecord): защита от чужой сборки
+    std::uint64_t fingerprint;
+    std::uint64_t dirCount;
+    std::uint64_t childCount;
+    std::uint64_t stringsSize;
+};
+
+struct DirRecord {
+    std::uint64_t pathOffset;
+    std::uint32_t pathLength;
+    std::uint32_t childCount;
+    std::uint64_t firstChild;
+    std::int64_t mtime;
+    std::int64_t ctime;
+    std::uint64_t device;
+    std::uint64_t inode;
+    std::uint64_t files;
+    std::uint64_t bytes;
+    std::uint64_t diskBytes;
+};
+
+struct ChildRecord {
+    std::uint64_t nameOffset;
+    std::uint32_t nameLength;
+    std::uint32_t recorded;
+};
+
+} // namespace
+
+ScanCache::~ScanCache() {
+    release();
+}
+
+void ScanCache::release() {
+#ifndef _WIN32
+    if (mapped && data) ::munmap(const_cast<char *>(data), dataSize);
+#endif
+    mapped = false;
+    data = nullptr;
+    dataSize = 0;
+    buffer.clear();
+    loadedDirs = 0;
+    loadedChildren = 0;
+}
+
+std::string ScanCache::defaultPath() {
+    return (fs::path(serviceDirectory()) / "scan.cache").string();
+}
+
+bool ScanCache::load(const std::string &path) {
+    release();
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(FileHeader))) {
+        ::close(fd);
+        return false;
+    }
+    void *mem = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED) return false;
+    data = static_cast<const char *>(mem);
+    dataSize = static_cast<size_t>(st.st_size);
+    mapped = true;
+#else
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    if (buffer.size() < sizeof(FileHeader)) return false;
+    data = buffer.data();
+    dataSize = buffer.size();
+#endif
+
+    FileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    std::uint64_t expectedSize = sizeof(FileHeader) + header.dirCount * sizeof(DirRecord) +
+                                 header.childCount * sizeof(ChildRecord) + header.stringsSize;
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+        header.recordSize != sizeof(DirRecord) || header.fingerprint != fingerprint ||
+        expectedSize != dataSize) {
+        release();
+        return false;
+    }
+    loadedDirs = static_cast<size_t>(header.dirCount);
+    loadedChildren = static_cast<size_t>(header.childCount);
+    return true;
+}
+
+bool ScanCache::lookup(const std::string &dir, const FileInfo &stamp, CachedDir &out) const {
+    if (!data || loadedDirs == 0) return false;
+    const auto *records = reinterpret_cast<const DirRecord *>(data + sizeof(FileHeader));
+    const auto *children = reinterpret_cast<const ChildRecord *>(records + loadedDirs);
+    const char *strings = reinterpret_cast<const char *>(children + loadedChildren);
+    size_t stringsSize = dataSize - static_cast<size_t>(strings - data);
+    auto text = [&](std::uint64_t offset, std::uint32_t length) {
+        if (offset + length > stringsSize) return std::string_view();
+        return std::string_view(strings + offset, length);
+    };
+
+    const DirRecord *end = records + loadedDirs;
+    const DirRecord *it = std::lower_bound(records, end, std::string_view(dir),
+        [&](const DirRecord &record, std::string_view key) {
+            return text(record.pathOffset, record.pathLength) < key;
+        });
+    if (it == end || text(it->pathOffset, it->pathLength) != dir) return false;
+    if (it->mtime != stamp.mtime || it->ctime != stamp.ctime ||
+        it->device != stamp.device || it->inode != stamp.inode) {
+        return false;
+    }
+    if (it->firstChild + it->childCount > loadedChildren) return false;
+
+    out.mtime = it->mtime;
+    out.ctime = it->ctime;
+    out.device = it->device;
+    out.inode = it->inode;
+    out.files = it->files;
+    out.bytes = it->bytes;
+    out.diskBytes = it->diskBytes;
+    out.children.clear();
+    out.children.reserve(it->childCount);
+    for (std::uint64_t i = 0; i < it->childCount; ++i) {
+        const ChildRecord &child = children[it->firstChild + i];
+        out.children.emplace_back(std::string(text(child.nameOffset, child.nameLength)), child.recorded != 0);
+    }
+    hits.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void ScanCache::store(const std::string &dir, CachedDir record) {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    updates.emplace_back(dir, std::move(record));
+}
+
+bool ScanCache::save(const std::string &path) const {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    // В файл попадают только директории, пройденные в этом запуске: удалённые
+    // и ставшие ненужными записи отбрасываются сами собой
+    std::vector<const std::pair<std::string, CachedDir> *> sorted;
+    sorted.reserve(updates.size());
+    for (const auto &update : updates) sorted.push_back(&update);
+    std::sort(sorted.begin(), sorted.end(),
+              [](const auto *a, const auto *b) { return a->first < b->first; });
+    sorted.erase(std::unique(sorted.begin(), sorted.end(),
+                             [](const auto *a, const auto *b) { return a->first == b->first; }),
+                 sorted.end());
+
+    std::vector<DirRecord> records;
+    std::vector<ChildRecord> children;
+    std::string strings;
+    records.reserve(sorted.size());
+    for (const auto *update : sorted) {
+        const CachedDir &dir = update->second;
+        DirRecord record;
+        std::memset(&record, 0, sizeof(record));
+        record.pathOffset = strings.size();
+        record.pathLength = static_cast<std::uint32_t>(update->first.size());
+        strings += update->first;
+        record.childCount = static_cast<std::uint32_t>(dir.children.size());
+        record.firstChild = children.size();
+        record.mtime = dir.mtime;
+        record.ctime = dir.ctime;
+        record.device = dir.device;
+        record.inode = dir.inode;
+        record.files = dir.files;
+        record.bytes = dir.bytes;
+        record.diskBytes = dir.diskBytes;
+        for (const auto &child : dir.children) {
+            ChildRecord out;
+            std::memset(&out, 0, sizeof(out));
+            out.nameOffset = strings.size();
+            out.nameLength = static_cast<std::uint32_t>(child.first.size());
+            out.recorded = child.second ? 1 : 0;
+            strings += child.first;
+            children.push_back(out);
+        }
+        records.push_back(record);
+    }
+
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.recordSize = sizeof(DirRecord);
+    header.fingerprint = fingerprint;
+    header.dirCount = records.size();
+    header.childCount = children.size();
+    header.stringsSize = strings.size();
+
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+    std::string temp = path + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(records.data()),
+                  static_cast<std::streamsize>(records.size() * sizeof(DirRecord)));
+        out.write(reinterpret_cast<const char *>(children.data()),
+                  static_cast<std::streamsize>(children.size() * sizeof(ChildRecord)));
+        out.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+        if (!out) {
+            fs::remove(temp, ec);
+            return false;
+        }
+    }
+    fs::rename(temp, path, ec);
+    if (ec) {
+        fs::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,73 @@
+#ifndef SCANCACHE_H
+#define SCANCACHE_H
+
+#include "fsops.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// Сохранённые итоги одной директории. Итоги только по её собственным файлам:
+/// mtime директории меняется лишь при изменении её элементов, поэтому каждая
+/// поддиректория проверяется отдельно.
+struct CachedDir {
+    std::int64_t mtime = 0;
+    std::int64_t ctime = 0;
+    std::uint64_t device = 0;
+    std::uint64_t inode = 0;
+    std::uint64_t files = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t diskBytes = 0;
+    std::vector<std::pair<std::string, bool>> children;   // Поддиректории: имя, учитывается ли сама
+};
+
+/// Кэш сканирования между запусками. Файл версионирован и читается через mmap:
+/// заголовок, отсортированный по пути массив записей фиксированного размера,
+/// массив поддиректорий и блок строк — поиск двоичный, без разбора при запуске.
+class ScanCache {
+public:
+    /// fingerprint — свёртка параметров обхода, при которых записи остаются верными
+    explicit ScanCache(std::uint64_t fingerprint) : fingerprint(fingerprint) {}
+    ~ScanCache();
+    ScanCache(const ScanCache &) = delete;
+    ScanCache &operator=(const ScanCache &) = delete;
+
+    /// Файл кэша по умолчанию: $XDG_CACHE_HOME/kleyner или ~/.cache/kleyner
+    static std::string defaultPath();
+
+    /// Загрузить кэш; при другой версии формата или других параметрах обхода
+    /// (fingerprint) кэш не используется
+    bool load(const std::string &path);
+
+    /// Записать обновлённые записи (через временный файл и rename)
+    bool save(const std::string &path) const;
+
+    /// Запись директории, если её метаданные не изменились
+    bool lookup(const std::string &dir, const FileInfo &stamp, CachedDir &out) const;
+
+    /// Запомнить итоги директории для следующего запуска (потокобезопасно)
+    void store(const std::string &dir, CachedDir record);
+
+    size_t loadedCount() const { return loadedDirs; }
+    size_t hitCount() const { return hits.load(std::memory_order_relaxed); }
+
+private:
+    std::uint64_t fingerprint = 0;
+    const char *data = nullptr;     // Отображённый файл (или buffer)
+    size_t dataSize = 0;
+    bool mapped = false;
+    std::vector<char> buffer;
+    size_t loadedDirs = 0;
+    size_t loadedChildren = 0;
+    mutable std::atomic<size_t> hits{0};
+
+    mutable std::mutex storeMutex;
+    std::vector<std::pair<std::string, CachedDir>> updates;
+
+    void release();
+};
+
+#endif // SCANCACHE_H
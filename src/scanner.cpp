@@ -0,0 +1,627 @@
+#include "scanner.h"
+#include "config.h"
+#include "fsops.h"
+#include "profile.h"
+#include "scancache.h"
+#include "threadpool.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+bool isProtectedPath(const std::string &path) {
+    return path.find("systemd-private") != std::string::npos;
+}
+
+bool isExcludedPath(const std::string &path, const std::unordered_set<std::string> *excluded) {
+    return excluded && !excluded->empty() && excluded->count(path) > 0;
+}
+
+bool isHiddenName(const std::string &name) {
+    return !name.empty() && name.front() == '.';
+}
+
+static bool isPermissionError(const std::error_code &ec) {
+    return ec == std::make_error_code(std::errc::permission_denied) ||
+           ec == std::make_error_code(std::errc::operation_not_permitted);
+}
+
+/// Удаляется ли файл по условиям фильтра
+static bool passesFilter(const RetentionFilter &filter, const std::string &name, const FileInfo &info,
+                         std::int64_t now) {
+    const std::int64_t second = 1000000000;
+    if (info.size < filter.minSize) return false;
+    if (filter.minAge > 0 && now - info.mtime < filter.minAge * second) return false;
+    if (filter.maxAtime > 0) {
+        // Без atime (переносимая реализация) ориентируемся на mtime
+        std::int64_t accessed = info.atime != 0 ? info.atime : info.mtime;
+        if (now - accessed < filter.maxAtime * second) return false;
+    }
+    if (filter.includeExt.empty() && filter.excludeExt.empty()) return true;
+
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    auto hasExtension = [&](const std::string &ext) {
+        return lower.size() > ext.size() && lower[lower.size() - ext.size() - 1] == '.' &&
+               lower.compare(lower.size() - ext.size(), ext.size(), ext) == 0;
+    };
+    if (!filter.includeExt.empty() &&
+        std::none_of(filter.includeExt.begin(), filter.includeExt.end(), hasExtension)) {
+        return false;
+    }
+    return std::none_of(filter.excludeExt.begin(), filter.excludeExt.end(), hasExtension);
+}
+
+namespace {
+
+/// Файл с несколькими жёсткими ссылками: учитывается после обхода всех целей
+struct LinkedFile {
+    std::uint64_t device;
+    std::uint64_t inode;
+    std::uint64_t links;
+    std::uintmax_t size;
+    std::uintmax_t allocated;
+};
+
+/// Итоги по файлам корня
+struct Usage {
+    size_t files = 0;
+    std::uintmax_t bytes = 0;
+    std::uintmax_t diskBytes = 0;
+    std::uintmax_t reclaimableBytes = 0;
+    std::vector<LinkedFile> linked;
+
+    void addFile(const FileInfo &info, bool inodeAccounting) {
+        files++;
+        if (inodeAccounting && info.links > 1 && info.inode != 0) {
+            linked.push_back({info.device, info.inode, info.links, info.size, info.allocated});
+            return;
+        }
+        bytes += info.size;
+        diskBytes += info.allocated;
+        reclaimableBytes += info.allocated;
+    }
+
+    void merge(Usage &other) {
+        files += other.files;
+        bytes += other.bytes;
+        diskBytes += other.diskBytes;
+        reclaimableBytes += other.reclaimableBytes;
+        linked.insert(linked.end(), other.linked.begin(), other.linked.end());
+    }
+};
+
+/// Компактная хеш-таблица inode с открытой адресацией.
+/// Для каждого (st_dev, st_ino) хранит, сколько его ссылок найдено в целях и какому корню он засчитан.
+class InodeTable {
+public:
+    static constexpr std::uint32_t noOwner = static_cast<std::uint32_t>(-1);
+
+    struct Slot {
+        std::uint64_t device = 0;
+        std::uint64_t inode = 0;
+        std::uint64_t links = 0;
+        std::uintmax_t allocated = 0;
+        std::uint32_t seen = 0;
+        std::uint32_t owner = noOwner;   // noOwner — ячейка свободна
+    };
+
+    /// Найти или добавить inode; inserted == true, если он встретился впервые
+    Slot &find(std::uint64_t device, std::uint64_t inode, bool &inserted) {
+        if ((used + 1) * 2 > slots.size()) grow();
+        Slot &slot = probe(slots, device, inode);
+        inserted = slot.owner == noOwner;
+        if (inserted) {
+            slot.device = device;
+            slot.inode = inode;
+            used++;
+        }
+        return slot;
+    }
+
+    const std::vector<Slot> &all() const { return slots; }
+
+private:
+    std::vector<Slot> slots;
+    size_t used = 0;
+
+    static std::uint64_t hash(std::uint64_t device, std::uint64_t inode) {
+        std::uint64_t h = inode ^ (device * 0x9E3779B97F4A7C15ULL);
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    /// Линейное пробирование; размер таблицы — степень двойки
+    static Slot &probe(std::vector<Slot> &table, std::uint64_t device, std::uint64_t inode) {
+        size_t mask = table.size() - 1;
+        size_t index = static_cast<size_t>(hash(device, inode)) & mask;
+        while (table[index].owner != noOwner &&
+               (table[index].device != device || table[index].inode != inode)) {
+            index = (index + 1) & mask;
+        }
+        return table[index];
+    }
+
+    void grow() {
+        std::vector<Slot> bigger(slots.empty() ? 1024 : slots.size() * 2);
+        for (const Slot &slot : slots) {
+            if (slot.owner != noOwner) probe(bigger, slot.device, slot.inode) = slot;
+        }
+        slots.swap(bigger);
+    }
+};
+
+/// Содержимое одной директории; поддиректории заполняются параллельно своими задачами
+struct DirNode {
+    struct Child {
+        ScanEntry entry;
+        FileInfo info;
+        bool recorded = true;            // false — скрытый элемент, сам не удаляется
+        bool retained = false;           // Оставлен фильтром (сам или что-то внутри)
+        std::unique_ptr<DirNode> node;   // Только для директорий
+    };
+    std::vector<Child> children;
+    std::string error;
+};
+
+/// Дерево одного корня: узлы, имена элементов и признак превышения предела памяти
+struct RootTree {
+    DirNode root;
+    std::mutex namesMutex;
+    PathArena names;
+    bool includeHidden = false;
+    std::atomic<bool> overBudget{false};
+};
+
+/// Итоги корня в режиме без хранения элементов (обновляются из разных потоков
+/// один раз на директорию)
+struct RootTotals {
+    bool includeHidden = false;
+    std::mutex mutex;
+    size_t dirs = 0;
+    Usage usage;
+    std::string error;
+};
+
+/// Элемент директории с уже определённым типом и размером
+struct ChildInfo {
+    std::string path;
+    bool directory = false;
+    bool recorded = true;   // false — скрытый элемент, сам не удаляется
+    FileInfo info;
+};
+
+/// Параллельный обход директорий: каждая директория — отдельная задача пула
+class ParallelWalker {
+public:
+    ParallelWalker(ThreadPool &pool, const ScanOptions &options)
+        : pool(pool), options(options), now(fileTimeNow()) {}
+
+    /// Обход без построения дерева: память пропорциональна фронту обхода, а не размеру дерева
+    void countDirectory(const std::string &dir, RootTotals *totals) {
+        FileInfo stamp;
+        bool stamped = false;
+        if (options.cache) {
+            std::error_code ec;
+            stamped = statPath(dir, stamp, ec);
+            CachedDir cached;
+            if (stamped && options.cache->lookup(dir, stamp, cached)) {
+                // Элементы директории не менялись: её файлы берём из кэша,
+                // поддиректории проверяются каждая отдельно
+                size_t dirs = 0;
+                for (const auto &child : cached.children) {
+                    if (child.second) dirs++;
+                    std::string subPath = joinPath(dir, child.first);
+                    pool.submit([this, subPath, totals] { countDirectory(subPath, totals); });
+                }
+                {
+                    std::lock_guard<std::mutex> lock(totals->mutex);
+                    totals->dirs += dirs;
+                    totals->usage.files += cached.files;
+                    totals->usage.bytes += cached.bytes;
+                    totals->usage.diskBytes += cached.diskBytes;
+                    totals->usage.reclaimableBytes += cached.diskBytes;
+                }
+                options.cache->store(dir, std::move(cached));
+                return;
+            }
+        }
+
+        size_t dirs = 0;
+        Usage usage;
+        CachedDir record;
+        std::string error = readDirectory(dir, totals->includeHidden, nullptr, [&](ChildInfo &child) {
+            if (child.directory) {
+                if (child.recorded) dirs++;
+                if (stamped) record.children.emplace_back(baseName(child.path), child.recorded);
+                std::string subPath = std::move(child.path);
+                pool.submit([this, subPath, totals] { countDirectory(subPath, totals); });
+                return;
+            }
+            if (!child.recorded) return;
+            usage.addFile(child.info, options.inodeAccounting);
+        });
+        if (stamped && error.empty()) {
+            record.mtime = stamp.mtime;
+            record.ctime = stamp.ctime;
+            record.device = stamp.device;
+            record.inode = stamp.inode;
+            record.files = usage.files;
+            record.bytes = usage.bytes;
+            record.diskBytes = usage.diskBytes;
+            options.cache->store(dir, std::move(record));
+        }
+        std::lock_guard<std::mutex> lock(totals->mutex);
+        totals->dirs += dirs;
+        totals->usage.merge(usage);
+        if (!error.empty() && totals->error.empty()) totals->error = error;
+    }
+
+    void walkDirectory(const std::string &dir, DirNode *node, const RetentionFilter *filter, RootTree *tree) {
+        // Предел памяти исчерпан: дерево корня всё равно будет отброшено
+        if (tree->overBudget.load(std::memory_order_relaxed)) return;
+        std::vector<std::string> names;
+        std::uintmax_t transient = 0;   // Временные имена: до записи в хранилище
+        node->error = readDirectory(dir, tree->includeHidden, tree, [&](ChildInfo &child) {
+            DirNode::Child out;
+            out.recorded = child.recorded;
+            names.push_back(baseName(child.path));
+            // Фильтр решает по уже полученным метаданным, без дополнительных вызовов
+            if (filter && child.recorded && !child.directory &&
+                !passesFilter(*filter, names.back(), child.info, now)) {
+                out.recorded = false;
+                out.retained = true;
+            }
+            out.entry.directory = child.directory;
+            out.entry.size = child.info.size;
+            out.entry.accessed = child.info.atime != 0 ? child.info.atime : child.info.mtime;
+            out.info = child.info;
+            if (child.directory) out.node = std::make_unique<DirNode>();
+            // Узел дерева и элемент снимка существуют одновременно при flatten
+            std::uintmax_t name = sizeof(std::string) + names.back().size();
+            transient += name;
+            charge(sizeof(DirNode::Child) + sizeof(ScanEntry) + (child.directory ? sizeof(DirNode) : 0) + name,
+                   tree);
+            node->children.push_back(std::move(out));
+        });
+        if (!tree->overBudget.load(std::memory_order_relaxed)) {
+            // Имена директории записываются одной блокировкой; в предел входят блоки хранилища
+            std::lock_guard<std::mutex> lock(tree->namesMutex);
+            size_t before = tree->names.capacity();
+            for (size_t i = 0; i < names.size(); ++i) {
+                node->children[i].entry.name = tree->names.store(names[i]);
+            }
+            charge(tree->names.capacity() - before, tree);
+        }
+        release(transient);
+        if (tree->overBudget.load(std::memory_order_relaxed)) return;
+
+        // Порядок детей не зависит от числа потоков и порядка выдачи ОС
+        std::sort(node->children.begin(), node->children.end(),
+                  [](const DirNode::Child &a, const DirNode::Child &b) {
+                      return a.entry.name < b.entry.name;
+                  });
+        for (auto &child : node->children) {
+            if (!child.node) continue;
+            DirNode *sub = child.node.get();
+            std::string subPath = joinPath(dir, std::string(child.entry.name));
+            pool.submit([this, subPath, sub, filter, tree] { walkDirectory(subPath, sub, filter, tree); });
+        }
+    }
+
+    std::int64_t currentTime() const { return now; }
+
+private:
+    ThreadPool &pool;
+    const ScanOptions &options;
+    std::int64_t now;       // Для фильтров по возрасту, в единицах FileInfo
+    std::atomic<std::uintmax_t> retained{0};    // Оценка памяти деревьев всех корней
+
+    /// Учесть память корня в пределе --max-memory; false — предел превышен, и дерево
+    /// корня будет отброшено (tree == nullptr — обход без дерева, не учитывается)
+    bool charge(std::uintmax_t bytes, RootTree *tree) {
+        if (options.memoryBudget == 0 || !tree) return true;
+        if (retained.fetch_add(bytes, std::memory_order_relaxed) + bytes <= options.memoryBudget) return true;
+        tree->overBudget.store(true, std::memory_order_relaxed);
+        return false;
+    }
+
+    /// Вернуть в предел временную память
+    void release(std::uintmax_t bytes) {
+        if (options.memoryBudget > 0) retained.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    /// Чтение одной директории. stat выполняется только там, где без него не обойтись:
+    /// для размера обычных файлов и когда ФС не сообщила тип элемента.
+    /// Возвращает текст ошибки (отказ в доступе ошибкой не считается).
+    /// С деревом tree память учитывается по мере чтения: директория с миллионами
+    /// элементов перестаёт читаться, как только превышен предел.
+    template <typename Visitor>
+    std::string readDirectory(const std::string &dir, bool includeHidden, RootTree *tree, Visitor &&visit) {
+        std::error_code ec;
+        DirHandle handle = DirHandle::open(dir, ec);
+        std::vector<ChildInfo> children;
+        std::vector<EntryKind> kinds;
+        std::vector<StatOp> stats;
+        std::vector<size_t> statIndex;
+        std::uintmax_t transient = 0;
+        DirItem item;
+        while (!ec && handle.next(item, ec)) {
+            PROFILE_COUNT(Entries, 1);
+            ChildInfo child;
+            child.path = joinPath(dir, item.name);
+            if (isProtectedPath(child.path) || isExcludedPath(child.path, options.excluded)) continue;
+            child.recorded = includeHidden || !isHiddenName(item.name);
+            if (item.kind == EntryKind::Unknown || (item.kind == EntryKind::File && child.recorded)) {
+                statIndex.push_back(children.size());
+                stats.push_back({item.name, FileInfo(), std::error_code()});
+            }
+            kinds.push_back(item.kind);
+            children.push_back(std::move(child));
+            // Временные записи директории: живут до конца её чтения
+            std::uintmax_t bytes = sizeof(ChildInfo) + sizeof(EntryKind) + sizeof(StatOp) + sizeof(size_t) +
+                                   children.back().path.size() + item.name.size();
+            transient += bytes;
+            if (!charge(bytes, tree)) break;
+        }
+        if (tree && tree->overBudget.load(std::memory_order_relaxed)) {
+            release(transient);
+            return std::string();
+        }
+
+        // Метаданные всей директории запрашиваются одним пакетом
+        handle.statBatch(stats);
+        for (size_t i = 0; i < stats.size(); ++i) {
+            if (stats[i].ec) continue;
+            kinds[statIndex[i]] = stats[i].info.kind;
+            children[statIndex[i]].info = stats[i].info;
+        }
+        for (size_t i = 0; i < children.size(); ++i) {
+            if (tree && tree->overBudget.load(std::memory_order_relaxed)) break;
+            children[i].directory = kinds[i] == EntryKind::Directory;
+            visit(children[i]);
+        }
+        release(transient);
+        if (ec && !isPermissionError(ec)) {
+            return std::system_error(ec, "directory_iterator: " + dir).what();
+        }
+        return std::string();
+    }
+};
+
+} // namespace
+
+/// Разворачивание дерева в плоский список (родитель раньше детей) с подсчётом итогов
+static void flatten(DirNode &node, size_t parent, PathScan &result, Usage &usage,
+                    const ScanOptions &options) {
+    if (!node.error.empty() && result.error.empty()) result.error = node.error;
+    for (auto &child : node.children) {
+        size_t index = ScanEntry::noParent;
+        if (child.recorded) {
+            index = result.entries.size();
+            child.entry.parent = parent;
+            if (child.entry.directory) {
+                result.dirs++;
+            } else {
+                usage.addFile(child.info, options.inodeAccounting);
+            }
+            result.entries.push_back(std::move(child.entry));
+        }
+        if (child.node) {
+            flatten(*child.node, index, result, usage, options);
+            child.node.reset();
+        }
+    }
+}
+
+static void collectFiles(DirNode &node, std::vector<DirNode::Child *> &files) {
+    for (auto &child : node.children) {
+        if (child.node) {
+            collectFiles(*child.node, files);
+        } else if (child.recorded && !child.entry.directory) {
+            files.push_back(&child);
+        }
+    }
+}
+
+/// Директории, внутри которых что-то оставлено, не удаляются. Пустые директории
+/// при фильтрах тоже остаются: их могли только что создать.
+static bool retainParents(DirNode &node) {
+    bool retained = false;
+    for (auto &child : node.children) {
+        if (child.node && (retainParents(*child.node) || child.node->children.empty())) {
+            child.recorded = false;
+            child.retained = true;
+        }
+        retained = retained || child.retained;
+    }
+    return retained;
+}
+
+/// Решения фильтра, которым нужно всё дерево корня: keep_newest и директории
+static void applyRetention(DirNode &root, const RetentionFilter &filter) {
+    if (filter.keepNewest > 0 || filter.keepNewestBytes > 0) {
+        std::vector<DirNode::Child *> files;
+        collectFiles(root, files);
+        std::sort(files.begin(), files.end(), [](const DirNode::Child *a, const DirNode::Child *b) {
+            return a->info.mtime > b->info.mtime;
+        });
+        std::uint64_t kept = 0;
+        std::uintmax_t bytes = 0;
+        for (DirNode::Child *file : files) {
+            if (filter.keepNewest > 0 && kept >= filter.keepNewest) break;
+            if (filter.keepNewestBytes > 0 && bytes + file->info.size > filter.keepNewestBytes) break;
+            file->recorded = false;
+            file->retained = true;
+            kept++;
+            bytes += file->info.size;
+        }
+    }
+    retainParents(root);
+}
+
+/// Подготовка корня: проверки существования и обработка случая, когда корень — файл.
+/// Возвращает true, если корень — директория и её нужно обойти.
+static bool prepareRoot(PathScan &result, Usage &usage, const ScanOptions &options,
+                        const RetentionFilter *filter, std::int64_t now) {
+    if (!pathExists(result.path)) return false;
+    result.exists = true;
+
+    if (isProtectedPath(result.path)) {
+        result.protectedPath = true;
+        return false;
+    }
+
+    std::error_code ec;
+    FileInfo info;
+    if (statPath(result.path, info, ec) && info.kind == EntryKind::File) {
+        result.regularFile = true;
+        if (filter && !passesFilter(*filter, baseName(result.path), info, now)) return false;
+        usage.addFile(info, options.inodeAccounting);
+        result.entries.push_back({std::string_view(), false, info.size, info.atime != 0 ? info.atime : info.mtime});
+        return false;
+    }
+
+    DirHandle probe = DirHandle::open(result.path, ec);
+    if (ec) {
+        result.denied = isPermissionError(ec);
+        result.error = fs::filesystem_error("directory_iterator", result.path, ec).what();
+        return false;
+    }
+    return true;
+}
+
+/// Итоги по файлам с жёсткими ссылками. Каждый inode засчитывается первому (по порядку целей)
+/// корню, где встретился, и освобождаемым считается, только если найдены все его ссылки.
+static void accountLinkedFiles(std::vector<PathScan> &results, std::vector<Usage> &usages) {
+    InodeTable table;
+    for (size_t i = 0; i < usages.size(); ++i) {
+        for (const LinkedFile &file : usages[i].linked) {
+            bool inserted = false;
+            InodeTable::Slot &slot = table.find(file.device, file.inode, inserted);
+            if (inserted) {
+                slot.owner = static_cast<std::uint32_t>(i);
+                slot.links = file.links;
+                slot.allocated = file.allocated;
+                results[i].bytes += file.size;
+                results[i].diskBytes += file.allocated;
+            }
+            slot.seen++;
+        }
+        usages[i].linked.clear();
+        usages[i].linked.shrink_to_fit();
+    }
+    for (const auto &slot : table.all()) {
+        if (slot.owner == InodeTable::noOwner || slot.seen < slot.links) continue;
+        results[slot.owner].reclaimableBytes += slot.allocated;
+    }
+}
+
+std::vector<PathScan> scanPaths(const std::vector<std::string> &paths, const ScanOptions &options) {
+    std::vector<PathScan> results(paths.size());
+    std::vector<Usage> usages(paths.size());
+    std::vector<std::unique_ptr<RootTree>> roots(paths.size());
+    std::vector<std::unique_ptr<RootTotals>> totals(paths.size());
+    std::vector<const RetentionFilter *> filters(paths.size(), nullptr);
+    for (size_t i = 0; options.filters && i < paths.size(); ++i) {
+        const RetentionFilter *filter = (*options.filters)[i];
+        if (filter && filter->active()) filters[i] = filter;
+    }
+    {
+        ThreadPool pool(options.jobs);
+        ParallelWalker walker(pool, options);
+        for (size_t i = 0; i < paths.size(); ++i) {
+            pool.submit([&, i] {
+                results[i].path = paths[i];
+                if (!prepareRoot(results[i], usages[i], options, filters[i], walker.currentTime())) return;
+                bool hidden = options.includeHidden || (options.hiddenPaths && (*options.hiddenPaths)[i]);
+                if (options.keepEntries || filters[i]) {
+                    roots[i] = std::make_unique<RootTree>();
+                    roots[i]->includeHidden = hidden;
+                    walker.walkDirectory(paths[i], &roots[i]->root, filters[i], roots[i].get());
+                } else {
+                    totals[i] = std::make_unique<RootTotals>();
+                    totals[i]->includeHidden = hidden;
+                    walker.countDirectory(paths[i], totals[i].get());
+                }
+            });
+        }
+        pool.wait();
+    }
+    for (size_t i = 0; i < paths.size(); ++i) {
+        if (roots[i] && roots[i]->overBudget) {
+            roots[i].reset();
+            results[i].error = "превышен предел памяти на элементы (--max-memory)";
+        }
+        if (roots[i] && filters[i]) applyRetention(roots[i]->root, *filters[i]);
+        if (roots[i]) {
+            flatten(roots[i]->root, ScanEntry::noParent, results[i], usages[i], options);
+            results[i].names = std::move(roots[i]->names);
+            roots[i].reset();
+        }
+        if (totals[i]) {
+            results[i].dirs = totals[i]->dirs;
+            results[i].error = totals[i]->error;
+            usages[i].merge(totals[i]->usage);
+        }
+        results[i].files = usages[i].files;
+        results[i].bytes = usages[i].bytes;
+        results[i].diskBytes = usages[i].diskBytes;
+        results[i].reclaimableBytes = usages[i].reclaimableBytes;
+    }
+    accountLinkedFiles(results, usages);
+    return results;
+}
+
+std::string entryPath(const PathScan &scan, size_t index) {
+#ifdef _WIN32
+    std::vector<std::string_view> names;
+    for (size_t i = index; i != ScanEntry::noParent; i = scan.entries[i].parent) names.push_back(scan.entries[i].name);
+    fs::path path(scan.path);
+    for (auto it = names.rbegin(); it != names.rend(); ++it) {
+        if (!it->empty()) path /= fs::path(std::string(*it));
+    }
+    return path.string();
+#else
+    // Длина считается первым проходом по цепочке, вторым имена пишутся с конца:
+    // одно выделение на путь
+    std::string_view root = scan.path;
+    if (!root.empty() && root.back() == '/') root.remove_suffix(1);
+    size_t length = root.size();
+    size_t parts = 0;
+    for (size_t i = index; i != ScanEntry::noParent; i = scan.entries[i].parent) {
+        if (scan.entries[i].name.empty()) continue;
+        length += scan.entries[i].name.size() + 1;
+        parts++;
+    }
+    if (parts == 0) return scan.path;
+    // Без корня первое имя — уже полный путь, разделитель перед ним не нужен
+    if (scan.path.empty()) length--;
+    std::string path(length, '/');
+    size_t pos = length;
+    for (size_t i = index; i != ScanEntry::noParent; i = scan.entries[i].parent) {
+        std::string_view name = scan.entries[i].name;
+        if (name.empty()) continue;
+        pos -= name.size();
+        path.replace(pos, name.size(), name.data(), name.size());
+        if (pos > 0) pos--;
+    }
+    path.replace(0, root.size(), root.data(), root.size());
+    return path;
+#endif
+}
+
+PathScan scanPath(const std::string &path, const ScanOptions &options) {
+    return std::move(scanPaths({path}, options).front());
+}
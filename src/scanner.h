@@ -0,0 +1,89 @@
+#ifndef SCANNER_H
+#define SCANNER_H
+
+#include "patharena.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+class ScanCache;
+struct RetentionFilter;
+
+/// Элемент дерева, найденный при сканировании. Хранится только имя (в PathArena
+/// своего PathScan): общий префикс пути не повторяется, полный путь собирается по
+/// цепочке родителей (см. entryPath).
+struct ScanEntry {
+    static constexpr size_t noParent = static_cast<size_t>(-1);
+
+    std::string_view name;      // Имя в родителе; у элемента без родителя — относительно корня
+    bool directory = false;
+    std::uintmax_t size = 0;
+    std::int64_t accessed = 0;  // Последний доступ к файлу (atime, без него — mtime), см. fileTimeNow
+    size_t parent = noParent;   // Индекс родительской директории в PathScan::entries
+};
+
+/// Результат сканирования одного пути из цели очистки
+struct PathScan {
+    std::string path;
+    bool exists = false;
+    bool regularFile = false;      // Путь сам является файлом
+    bool protectedPath = false;    // Защищённый системный путь (systemd-private)
+    bool denied = false;           // Отказ в доступе к корню
+    std::string error;
+    size_t files = 0;
+    size_t dirs = 0;
+    std::uintmax_t bytes = 0;             // Видимый размер файлов
+    std::uintmax_t diskBytes = 0;         // Занято на диске (st_blocks * 512)
+    std::uintmax_t reclaimableBytes = 0;  // Освободится на диске после удаления
+    std::vector<ScanEntry> entries; // Элементы к удалению в порядке обхода (родитель раньше детей)
+    PathArena names;                // Имена элементов
+};
+
+/// Полный путь элемента: корень, имена родителей и имя элемента. Пустое имя — сам
+/// корень (цель-файл); при пустом корне имя элемента — уже полный путь.
+std::string entryPath(const PathScan &scan, size_t index);
+
+/// Параметры сканирования
+struct ScanOptions {
+    bool includeHidden = false;
+    unsigned jobs = 0;          // Число потоков обхода (0 — по числу ядер)
+    bool keepEntries = true;    // false — только итоги, список элементов не хранится
+    // Учёт по inode: файл с несколькими жёсткими ссылками считается один раз на все цели,
+    // а освобождаемым — только если все его ссылки внутри набора очистки
+    bool inodeAccounting = false;
+    // Пути, принадлежащие другим (более точным) целям: не обходятся и не учитываются
+    const std::unordered_set<std::string> *excluded = nullptr;
+    // Кэш между запусками (только без хранения элементов и без учёта по inode):
+    // неизменённые директории не читаются, их файлы берутся из кэша
+    ScanCache *cache = nullptr;
+    // Условия удаления по индексу пути (nullptr — удаляется всё). Такие пути всегда
+    // обходятся с построением дерева: keep_newest и пустые директории решаются после обхода
+    const std::vector<const RetentionFilter *> *filters = nullptr;
+    // Учитывать скрытые элементы по индексу пути, помимо includeHidden (цели,
+    // переносимые в корзину, уходят целиком вместе со скрытыми)
+    const std::vector<bool> *hiddenPaths = nullptr;
+    // Предел памяти на деревья и элементы всех путей (0 — без предела). Путь, не
+    // уместившийся в предел, получает ошибку и элементов не содержит
+    std::uintmax_t memoryBudget = 0;
+};
+
+/// Защищённый системный путь, который никогда не обходится и не удаляется
+bool isProtectedPath(const std::string &path);
+
+/// Путь внутри цели, который принадлежит другой цели
+bool isExcludedPath(const std::string &path, const std::unordered_set<std::string> *excluded);
+
+/// Скрытое имя (начинается с точки)
+bool isHiddenName(const std::string &name);
+
+/// Однократный параллельный обход набора путей: собирает элементы к удалению и их размер.
+/// Результат детерминирован и не зависит от числа потоков.
+std::vector<PathScan> scanPaths(const std::vector<std::string> &paths, const ScanOptions &options);
+
+/// Обход одного пути
+PathScan scanPath(const std::string &path, const ScanOptions &options);
+
+#endif // SCANNER_H
@@ -0,0 +1,105 @@
+#include "threadpool.h"
+
+// Пул и индекс очереди текущего рабочего потока (для постановки задач в свою очередь)
+static thread_local ThreadPool *t_pool = nullptr;
+static thread_local size_t t_index = 0;
+
+unsigned ThreadPool::resolveThreads(unsigned jobs) {
+    if (jobs > 0) return jobs;
+    unsigned hw = std::thread::hardware_concurrency();
+    return hw > 0 ? hw : 1;
+}
+
+ThreadPool::ThreadPool(unsigned threads) {
+    threads = resolveThreads(threads);
+    queues.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    workers.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) {
+        workers.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    wakeup.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(Task task) {
+    size_t index;
+    {
+        // Счётчики растут до того, как задачу можно украсть: иначе другой поток успеет
+        // выполнить её и обнулить pending, пока родительская задача ещё работает
+        std::lock_guard<std::mutex> lock(stateMutex);
+        index = t_pool == this ? t_index : nextQueue++ % queues.size();
+        ++queued;
+        ++pending;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    wakeup.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    idle.wait(lock, [this] { return pending == 0; });
+}
+
+bool ThreadPool::popLocal(size_t index, Task &task) {
+    Queue &queue = *queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) return false;
+    // Свои задачи берём с конца (LIFO): обход идёт в глубину и кэш остаётся тёплым
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(size_t index, Task &task) {
+    for (size_t i = 1; i < queues.size(); ++i) {
+        Queue &queue = *queues[(index + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) continue;
+        // Чужие задачи крадём с начала: там самые крупные поддеревья
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    t_pool = this;
+    t_index = index;
+    while (true) {
+        Task task;
+        if (popLocal(index, task) || steal(index, task)) {
+            {
+                std::lock_guard<std::mutex> lock(stateMutex);
+                --queued;
+            }
+            try {
+                task();
+            } catch (...) {
+                // Задачи сами сообщают об ошибках; исключение не должно останавливать поток
+            }
+            std::lock_guard<std::mutex> lock(stateMutex);
+            if (--pending == 0) idle.notify_all();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(stateMutex);
+        wakeup.wait(lock, [this] { return stopping || queued > 0; });
+        if (stopping && queued == 0) return;
+    }
+}
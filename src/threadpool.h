@@ -0,0 +1,58 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Пул потоков с очередью на каждый поток и кражей задач (work-stealing).
+/// Задача, поставленная из рабочего потока, попадает в его собственную очередь;
+/// свободные потоки забирают задачи из чужих очередей.
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    /// threads == 0 — по числу аппаратных потоков
+    explicit ThreadPool(unsigned threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /// Поставить задачу в очередь (можно вызывать из задач пула)
+    void submit(Task task);
+
+    /// Дождаться выполнения всех задач, включая порождённые другими задачами
+    void wait();
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+    /// Число потоков по умолчанию для значения jobs из конфига
+    static unsigned resolveThreads(unsigned jobs);
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex stateMutex;
+    std::condition_variable wakeup;
+    std::condition_variable idle;
+    size_t queued = 0;   // Задачи в очередях
+    size_t pending = 0;  // Задачи поставленные, но ещё не завершённые
+    size_t nextQueue = 0;
+    bool stopping = false;
+
+    bool popLocal(size_t index, Task &task);
+    bool steal(size_t index, Task &task);
+    void workerLoop(size_t index);
+};
+
+#endif // THREADPOOL_H
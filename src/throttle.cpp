@@ -0,0 +1,27 @@
+#include "throttle.h"
+#include "profile.h"
+
+#include <algorithm>
+#include <thread>
+
+TokenBucket::TokenBucket(double rate)
+    : rate(rate),
+      burst(std::max(rate / 10, 1.0)),
+      tokens(burst),
+      last(Clock::now()) {}
+
+void TokenBucket::acquire(double amount) {
+    if (rate <= 0 || amount <= 0) return;
+    double debt;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto now = Clock::now();
+        tokens = std::min(burst, tokens + std::chrono::duration<double>(now - last).count() * rate);
+        last = now;
+        tokens -= amount;
+        debt = -tokens;
+    }
+    if (debt <= 0) return;
+    PROFILE_SCOPE("TokenBucket::wait");
+    std::this_thread::sleep_for(std::chrono::duration<double>(debt / rate));
+}
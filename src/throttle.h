@@ -0,0 +1,31 @@
+#ifndef THROTTLE_H
+#define THROTTLE_H
+
+#include <chrono>
+#include <mutex>
+
+/// Ограничение скорости «ведром токенов»: rate единиц в секунду, запас — на 100 мс.
+/// Запрос больше запаса уходит в долг, и следующие запросы ждут его погашения, поэтому
+/// средняя скорость соблюдается при любом размере пакетов. Потокобезопасно: ожидание
+/// идёт без блокировки, очередь из нескольких потоков получает токены по порядку.
+class TokenBucket {
+public:
+    /// rate == 0 — без ограничения
+    explicit TokenBucket(double rate = 0);
+
+    bool enabled() const { return rate > 0; }
+
+    /// Забрать amount единиц; при нехватке поток засыпает до их появления
+    void acquire(double amount);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::mutex mutex;
+    double rate;
+    double burst;
+    double tokens;
+    Clock::time_point last;
+};
+
+#endif // THROTTLE_H
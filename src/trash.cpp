@@ -0,0 +1,376 @@
+#include "trash.h"
+#include "deleter.h"
+#include "fsops.h"
+#include "logger.h"
+#include "process.h"
+#include "profile.h"
+#include "scanner.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <process.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char kTrashName[] = ".kleyner-trash";
+
+std::string defaultTrash() {
+    return (fs::path(serviceDirectory()) / "trash").string();
+}
+
+std::string listPath() {
+    return (fs::path(serviceDirectory()) / "trash.list").string();
+}
+
+/// Блокировка файла (flock) на время жизни объекта; на Windows ничего не делает
+class FileLock {
+public:
+    explicit FileLock(const std::string &path) {
+#ifndef _WIN32
+        std::error_code ec;
+        fs::create_directories(fs::path(path).parent_path(), ec);
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if (fd >= 0) {
+            while (::flock(fd, LOCK_EX) != 0 && errno == EINTR) {}
+        }
+#else
+        (void)path;
+#endif
+    }
+    ~FileLock() {
+#ifndef _WIN32
+        if (fd >= 0) ::close(fd);
+#endif
+    }
+    FileLock(const FileLock &) = delete;
+    FileLock &operator=(const FileLock &) = delete;
+
+private:
+#ifndef _WIN32
+    int fd = -1;
+#endif
+};
+
+/// Корзины: по умолчанию и все из списка (вызывать под блокировкой списка)
+std::vector<std::string> readTrashList() {
+    std::vector<std::string> dirs{defaultTrash()};
+    std::ifstream in(listPath());
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && std::find(dirs.begin(), dirs.end(), line) == dirs.end()) dirs.push_back(line);
+    }
+    return dirs;
+}
+
+void writeTrashList(const std::vector<std::string> &dirs) {
+    std::string path = listPath();
+    std::string temp = path + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::trunc);
+        for (const auto &dir : dirs) {
+            if (dir != defaultTrash()) out << dir << '\n';
+        }
+    }
+    std::error_code ec;
+    fs::rename(temp, path, ec);
+}
+
+void registerTrash(const std::string &dir) {
+    std::vector<std::string> dirs = readTrashList();
+    if (std::find(dirs.begin(), dirs.end(), dir) != dirs.end()) return;
+    dirs.push_back(dir);
+    writeTrashList(dirs);
+}
+
+/// Уникальное нескрытое имя для дерева в корзине
+std::string stagedName() {
+    static std::atomic<unsigned> counter{0};
+    auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+#ifndef _WIN32
+    long pid = static_cast<long>(::getpid());
+#else
+    long pid = static_cast<long>(::_getpid());
+#endif
+    return std::to_string(now) + "-" + std::to_string(pid) + "-" + std::to_string(counter++);
+}
+
+/// Путь без завершающего разделителя: у "/tmp/" родитель — "/", а не "/tmp"
+fs::path normalTarget(const std::string &target) {
+    fs::path path = fs::path(target).lexically_normal();
+    if (!path.has_filename() && path.has_relative_path()) path = path.parent_path();
+    return path;
+}
+
+/// Является ли цель точкой монтирования (её устройство отличается от родительского)
+bool isMountPoint(const std::string &target) {
+    fs::path path = normalTarget(target);
+    FileInfo info, parent;
+    std::error_code ec;
+    if (!statPath(path.string(), info, ec)) return false;
+    return !path.has_relative_path() ||
+           (statPath(path.parent_path().string(), parent, ec) && parent.device != info.device);
+}
+
+/// Корзины, подходящие для цели, в порядке предпочтения. Подходит ли корзина
+/// (та же ФС), выясняется попыткой rename(): EXDEV — пробуем следующую.
+/// Устройство и корень ФС берутся от самой цели: если она — точка монтирования
+/// (tmpfs /tmp), корзины на ФС родителя не годятся. При переносе целиком
+/// последняя корзина лежит рядом с целью, при переносе элементов — внутри неё.
+std::vector<std::string> trashCandidates(const std::string &target, bool whole) {
+    std::vector<std::string> candidates{defaultTrash()};
+    fs::path path = normalTarget(target);
+    FileInfo info;
+    std::error_code ec;
+    if (statPath(path.string(), info, ec) && info.device != 0) {
+        // Корень ФС: самый верхний предок на том же устройстве
+        fs::path root = path;
+        while (root.has_relative_path()) {
+            FileInfo upper;
+            if (!statPath(root.parent_path().string(), upper, ec) || upper.device != info.device) break;
+            root = root.parent_path();
+        }
+        candidates.push_back((root / kTrashName).string());
+    }
+    std::string nearby = ((whole ? path.parent_path() : path) / kTrashName).string();
+    if (std::find(candidates.begin(), candidates.end(), nearby) == candidates.end()) candidates.push_back(nearby);
+    return candidates;
+}
+
+/// Подготовить корзину: created — создана сейчас (убрать, если не пригодилась)
+bool prepareTrash(const std::string &dir, bool &created, std::error_code &ec) {
+    created = fs::create_directories(dir, ec);
+    if (ec) return false;
+    if (created) fs::permissions(dir, fs::perms::owner_all, ec);
+    ec.clear();
+    return true;
+}
+
+/// Перенос директории целиком; при recreate на её месте создаётся пустая
+bool stageWhole(const std::string &target, bool recreate, std::string &error) {
+    std::error_code ec;
+    fs::perms perms = fs::status(target, ec).permissions();
+#ifndef _WIN32
+    struct stat st;
+    bool owned = ::stat(target.c_str(), &st) == 0;
+#endif
+    for (const auto &trash : trashCandidates(target, true)) {
+        bool created = false;
+        if (!prepareTrash(trash, created, ec)) {
+            error = ec.message();
+            continue;
+        }
+        fs::rename(target, fs::path(trash) / stagedName(), ec);
+        if (ec) {
+            error = ec.message();
+            if (created) fs::remove(trash, ec);
+            continue;
+        }
+        registerTrash(trash);
+        if (recreate) {
+            fs::create_directory(target, ec);
+            if (!ec) fs::permissions(target, perms, ec);
+#ifndef _WIN32
+            if (!ec && owned && ::geteuid() == 0 && ::chown(target.c_str(), st.st_uid, st.st_gid) != 0) {
+                LOG_WARNING("Не удалось восстановить владельца " + target);
+            }
+#endif
+            if (ec) LOG_WARNING("Не удалось пересоздать " + target + ": " + ec.message());
+        }
+        return true;
+    }
+    return false;
+}
+
+/// Элементы верхнего уровня, которые переносятся в корзину. Пропускается то же, что
+/// и при обходе цели (служебные пути, вложенные цели), а также корзина внутри цели;
+/// skipped — что-то осталось на месте. Скрытые элементы переносятся: цель в корзине
+/// обходится вместе с ними.
+bool listStaged(const std::string &target, const std::unordered_set<std::string> &excluded,
+                std::vector<std::string> &names, bool &skipped, std::string &error) {
+    std::error_code ec;
+    DirHandle dir = DirHandle::open(target, ec);
+    DirItem item;
+    while (!ec && dir.next(item, ec)) {
+        std::string path = joinPath(target, item.name);
+        if (item.name == kTrashName || isProtectedPath(path) || isExcludedPath(path, &excluded)) {
+            skipped = true;
+            continue;
+        }
+        names.push_back(item.name);
+    }
+    if (ec) {
+        error = ec.message();
+        return false;
+    }
+    return true;
+}
+
+/// Перенос выбранных элементов верхнего уровня в одну директорию корзины
+bool stageChildren(const std::string &target, const std::vector<std::string> &names, std::string &error) {
+    std::error_code ec;
+    for (const auto &trash : trashCandidates(target, false)) {
+        bool created = false;
+        if (!prepareTrash(trash, created, ec)) {
+            error = ec.message();
+            continue;
+        }
+        fs::path unit = fs::path(trash) / stagedName();
+        fs::create_directory(unit, ec);
+        if (!ec) fs::rename(fs::path(target) / names.front(), unit / names.front(), ec);
+        if (ec) {
+            // Другая ФС или нет прав: следующая корзина
+            error = ec.message();
+            fs::remove(unit, ec);
+            if (created) fs::remove(trash, ec);
+            continue;
+        }
+        registerTrash(trash);
+        bool complete = true;
+        for (size_t i = 1; i < names.size(); ++i) {
+            fs::rename(fs::path(target) / names[i], unit / names[i], ec);
+            if (ec && ec != std::errc::no_such_file_or_directory) {
+                error = names[i] + ": " + ec.message();
+                complete = false;
+            }
+        }
+        return complete;
+    }
+    return false;
+}
+
+bool isEmptyDirectory(const std::string &path) {
+    std::error_code ec;
+    return fs::is_empty(path, ec) || ec;
+}
+
+} // namespace
+
+bool trashAllowed(const std::string &target) {
+    std::string service = serviceDirectory();
+    std::string path = fs::path(target).lexically_normal().string();
+    while (path.size() > 1 && path.back() == '/') path.pop_back();
+    return !(service == path || (service.compare(0, path.size(), path) == 0 &&
+                                 (service[path.size()] == '/' || path.back() == '/')));
+}
+
+bool stageToTrash(const std::string &target, const Config &config,
+                  const std::unordered_set<std::string> &excluded, std::string &error) {
+    PROFILE_SCOPE("stageToTrash");
+    // Список корзин меняется под блокировкой: фоновый процесс не уберёт пустую
+    // корзину между её выбором и переносом
+    FileLock lock(listPath() + ".lock");
+    std::vector<std::string> names;
+    bool skipped = false;
+    if (!listStaged(target, excluded, names, skipped, error)) return false;
+    if (names.empty()) return true;
+    // Точку монтирования rename() не перенесёт, а пропущенное должно остаться на месте
+    if (!skipped && !isMountPoint(target)) return stageWhole(target, config.trashRecreate, error);
+    return stageChildren(target, names, error);
+}
+
+bool trashPending() {
+    // Без корзины по умолчанию и списка корзина не использовалась: блокировка
+    // создала бы служебную директорию на машине, где --trash не включали
+    if (!pathExists(defaultTrash()) && !pathExists(listPath())) return false;
+    FileLock lock(listPath() + ".lock");
+    for (const auto &dir : readTrashList()) {
+        if (!isEmptyDirectory(dir)) return true;
+    }
+    return false;
+}
+
+bool startTrashPurge(const Config &config, std::string &error) {
+    std::string self = selfExecutable();
+    if (self.empty()) {
+        error = "путь к исполняемому файлу неизвестен";
+        return false;
+    }
+    std::vector<std::string> argv{self, "--purge-trash", "--config", config.configFile};
+    if (config.verbose) argv.push_back("--verbose");
+    std::string log = (fs::path(serviceDirectory()) / "trash.log").string();
+    int pid = spawnDetached(argv, log, error);
+    if (pid < 0) return false;
+    LOG_DEBUG("Фоновое удаление корзины: pid " + std::to_string(pid) + ", журнал " + log);
+    return true;
+}
+
+int purgeTrash(const Config &config) {
+    PROFILE_SCOPE("purgeTrash");
+    std::string error;
+    if (!setProcessPriority(19, true, error)) LOG_DEBUG("Приоритет фонового удаления: " + error);
+    // Один процесс удаления за раз: следующий дождётся и дочистит поступившее позже
+    FileLock worker((fs::path(serviceDirectory()) / "trash.lock").string());
+
+    DeleteOptions options;
+    options.jobs = 1;               // Фоновая работа: один поток, приоритет idle
+    options.maxInFlight = config.maxInFlight;
+    options.maxOpsPerSec = config.maxUnlinkRate;
+    options.maxBytesPerSec = config.maxFreeRate;
+    options.includeHidden = true;
+    std::atomic<std::uint64_t> removed{0};
+    std::atomic<std::uint64_t> failed{0};
+    auto onResult = [&](const ScanEntry &, const std::string &path, size_t, bool ok, const std::error_code &ec) {
+        if (ec) {
+            failed++;
+            LOG_WARNING("Ошибка удаления " + path + ": " + ec.message());
+        } else if (ok) {
+            removed++;
+        }
+    };
+
+    auto started = std::chrono::steady_clock::now();
+    for (;;) {
+        std::vector<std::string> dirs;
+        {
+            FileLock lock(listPath() + ".lock");
+            dirs = readTrashList();
+        }
+        std::uint64_t before = removed;
+        bool pending = false;
+        {
+            Deleter deleter(options, onResult);
+            for (const auto &dir : dirs) {
+                if (isEmptyDirectory(dir)) continue;
+                pending = true;
+                LOG_DEBUG("Удаление корзины " + dir);
+                deleter.addStream(dir);
+            }
+            deleter.wait();
+        }
+        // Без продвижения (ошибки доступа) новый проход не поможет
+        if (!pending || removed == before) break;
+    }
+
+    {
+        // Пустые корзины, кроме корзины по умолчанию, убираются вместе с записью в списке
+        FileLock lock(listPath() + ".lock");
+        std::vector<std::string> kept;
+        for (const auto &dir : readTrashList()) {
+            std::error_code ec;
+            if (dir != defaultTrash() && isEmptyDirectory(dir)) fs::remove(dir, ec);
+            if (fs::exists(dir, ec)) kept.push_back(dir);
+        }
+        writeTrashList(kept);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    LOG_INFO("Корзина очищена: удалено " + std::to_string(removed.load()) + " элементов за " +
+             std::to_string(static_cast<long long>(seconds)) + " с, ошибок: " + std::to_string(failed.load()));
+    return failed == 0 ? 0 : 1;
+}
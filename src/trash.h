@@ -0,0 +1,41 @@
+#ifndef TRASH_H
+#define TRASH_H
+
+#include "config.h"
+
+#include <string>
+#include <unordered_set>
+
+/// Корзина (--trash): содержимое цели одним rename() переносится в директорию-корзину
+/// на той же ФС, путь сразу свободен, а сами деревья удаляет отдельный фоновый процесс
+/// с пониженным приоритетом (cleaner --purge-trash). Корзины по порядку выбора:
+/// $XDG_CACHE_HOME/kleyner/trash (~/.cache/kleyner/trash), `.kleyner-trash` в корне ФС
+/// цели, `.kleyner-trash` рядом с целью (или внутри неё при переносе элементов). Использованные корзины перечислены в
+/// ~/.cache/kleyner/trash.list: деревья, оставшиеся после сбоя, дочищаются при
+/// следующем запуске.
+
+/// Можно ли переносить цель: она не должна содержать служебную директорию kleyner
+/// (в ней список корзин и сама корзина по умолчанию)
+bool trashAllowed(const std::string &target);
+
+/// Перенести цель в корзину вместе со скрытыми элементами. Элементы, которые обход цели
+/// пропускает (служебные пути, вложенные цели из excluded), остаются на месте, и тогда
+/// переносятся остальные элементы верхнего уровня; так же и для точки монтирования.
+/// Иначе директория переносится целиком и при trash_recreate создаётся заново пустой
+/// (с прежними правами и владельцем). false — перенесено не всё (причина в error),
+/// оставшееся нужно удалить обычным способом.
+bool stageToTrash(const std::string &target, const Config &config,
+                  const std::unordered_set<std::string> &excluded, std::string &error);
+
+/// Есть ли в корзинах неудалённые деревья (без следов корзины ничего не создаёт)
+bool trashPending();
+
+/// Запустить фоновое удаление корзин (журнал — ~/.cache/kleyner/trash.log)
+bool startTrashPurge(const Config &config, std::string &error);
+
+/// Удаление содержимого всех корзин в текущем процессе (режим --purge-trash) с
+/// пониженным приоритетом. Одновременно работает один такой процесс; проходы
+/// повторяются, пока в корзины поступают новые деревья. Возвращает код завершения.
+int purgeTrash(const Config &config);
+
+#endif // TRASH_H
@@ -0,0 +1,203 @@
+#include "uring.h"
+
+#ifdef CLEANER_URING
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <memory>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static int sysSetup(unsigned entries, io_uring_params *params) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int sysEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+static int sysRegister(int fd, unsigned opcode, void *arg, unsigned nrArgs) {
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs));
+}
+
+IoUring::~IoUring() {
+    if (sqesMem) ::munmap(sqesMem, sqesSize);
+    if (cqRing && cqRing != sqRing) ::munmap(cqRing, cqRingSize);
+    if (sqRing) ::munmap(sqRing, sqRingSize);
+    if (fd >= 0) ::close(fd);
+}
+
+bool IoUring::init(unsigned entries) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    fd = sysSetup(entries, &params);
+    if (fd < 0) return false;
+    ringEntries = params.sq_entries;
+
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMmap) {
+        if (cqRingSize > sqRingSize) sqRingSize = cqRingSize;
+        cqRingSize = sqRingSize;
+    }
+
+    sqRing = ::mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    fd, IORING_OFF_SQ_RING);
+    if (sqRing == MAP_FAILED) {
+        sqRing = nullptr;
+        return false;
+    }
+    if (singleMmap) {
+        cqRing = sqRing;
+    } else {
+        cqRing = ::mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        fd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) {
+            cqRing = nullptr;
+            return false;
+        }
+    }
+    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    sqesMem = ::mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     fd, IORING_OFF_SQES);
+    if (sqesMem == MAP_FAILED) {
+        sqesMem = nullptr;
+        return false;
+    }
+
+    char *sq = static_cast<char *>(sqRing);
+    sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sqMask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    char *cq = static_cast<char *>(cqRing);
+    cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cqMask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes = cq + params.cq_off.cqes;
+    return true;
+}
+
+bool IoUring::run(std::vector<Op> &ops) {
+    if (broken) return false;
+    auto *sqes = static_cast<io_uring_sqe *>(sqesMem);
+    auto *cqeArray = static_cast<io_uring_cqe *>(cqes);
+    for (Op &op : ops) op.done = false;
+    // Все готовые завершения: результат записывается в операцию текущего пакета
+    auto reap = [&]() {
+        unsigned head = *cqHead;
+        unsigned cqTailNow = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        unsigned reaped = 0;
+        while (head != cqTailNow) {
+            const io_uring_cqe &cqe = cqeArray[head & *cqMask];
+            if (cqe.user_data < ops.size()) {
+                ops[cqe.user_data].res = cqe.res;
+                ops[cqe.user_data].done = true;
+            }
+            ++head;
+            ++reaped;
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+        return reaped;
+    };
+    size_t next = 0;
+    while (next < ops.size()) {
+        // Заполняем очередь отправки порцией не больше размера кольца
+        unsigned tail = *sqTail;
+        unsigned count = 0;
+        while (next < ops.size() && count < ringEntries) {
+            Op &op = ops[next];
+            unsigned index = tail & *sqMask;
+            io_uring_sqe &sqe = sqes[index];
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.fd = op.dirfd;
+            sqe.addr = reinterpret_cast<uint64_t>(op.path);
+            sqe.user_data = next;
+            if (op.type == Op::Statx) {
+                sqe.opcode = IORING_OP_STATX;
+                sqe.len = STATX_BASIC_STATS;
+                sqe.off = reinterpret_cast<uint64_t>(op.statxBuf);
+                sqe.statx_flags = static_cast<uint32_t>(op.flags);
+            } else {
+                sqe.opcode = IORING_OP_UNLINKAT;
+                sqe.unlink_flags = static_cast<uint32_t>(op.flags);
+            }
+            sqArray[index] = index;
+            ++tail;
+            ++count;
+            ++next;
+        }
+        __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+
+        unsigned completed = 0;
+        unsigned submitted = 0;
+        while (completed < count) {
+            unsigned toSubmit = count - submitted;
+            int rc = sysEnter(fd, toSubmit, 1, IORING_ENTER_GETEVENTS);
+            if (rc < 0) {
+                if (errno == EINTR) continue;
+                // Уже отправленные операции дожидаемся, чтобы их завершения не достались
+                // следующему пакету, а синхронный откат не повторил выполненное.
+                // Неотправленные остаются в очереди и пропадают вместе с кольцом.
+                completed += reap();
+                while (completed < submitted) {
+                    if (sysEnter(fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) break;
+                    completed += reap();
+                }
+                broken = true;
+                return false;
+            }
+            submitted += static_cast<unsigned>(rc) < toSubmit ? static_cast<unsigned>(rc) : toSubmit;
+            completed += reap();
+        }
+    }
+    return true;
+}
+
+bool IoUring::available() {
+    static std::once_flag once;
+    static bool supported = false;
+    std::call_once(once, [] {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        int ringFd = sysSetup(4, &params);
+        if (ringFd < 0) return;   // ENOSYS (старое ядро), EPERM (seccomp/sysctl)
+        size_t probeSize = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+        std::unique_ptr<char[]> probeMem(new char[probeSize]());
+        auto *probe = reinterpret_cast<io_uring_probe *>(probeMem.get());
+        if (sysRegister(ringFd, IORING_REGISTER_PROBE, probe, 256) == 0) {
+            auto opSupported = [probe](unsigned op) {
+                return op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+            };
+            supported = opSupported(IORING_OP_STATX) && opSupported(IORING_OP_UNLINKAT);
+        }
+        ::close(ringFd);
+    });
+    return supported;
+}
+
+IoUring *IoUring::threadLocal() {
+    thread_local std::unique_ptr<IoUring> ring;
+    thread_local bool failed = false;
+    if (ring && ring->broken) {
+        // После сбоя поток работает синхронно
+        ring.reset();
+        failed = true;
+    }
+    if (!ring && !failed) {
+        auto created = std::make_unique<IoUring>();
+        if (created->init(256)) {
+            ring = std::move(created);
+        } else {
+            failed = true;
+        }
+    }
+    return ring.get();
+}
+
+#endif // CLEANER_URING
@@ -0,0 +1,76 @@
+#ifndef URING_H
+#define URING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Пакетные statx/unlinkat через io_uring (без liburing: кольца настраиваются
+// напрямую через io_uring_setup/io_uring_enter). Собирается с -DCLEANER_ENABLE_URING=ON.
+#if defined(__linux__) && !defined(CLEANER_PORTABLE_FS) && defined(CLEANER_ENABLE_URING)
+#define CLEANER_URING 1
+#endif
+
+#ifdef CLEANER_URING
+
+#include <sys/stat.h>
+
+/// Одно кольцо io_uring. Не потокобезопасно: у каждого рабочего потока своё кольцо.
+class IoUring {
+public:
+    /// Описание операции пакета; результат — res (>= 0 успех, иначе -errno)
+    struct Op {
+        enum Type { Statx, Unlinkat } type = Statx;
+        int dirfd = -1;
+        const char *path = nullptr;
+        int flags = 0;                      // AT_SYMLINK_NOFOLLOW / AT_REMOVEDIR
+        struct statx *statxBuf = nullptr;   // Только для Statx
+        int res = 0;
+        bool done = false;                  // Завершение получено, res действителен
+    };
+
+    IoUring() = default;
+    ~IoUring();
+    IoUring(const IoUring &) = delete;
+    IoUring &operator=(const IoUring &) = delete;
+
+    /// Создать кольцо на entries элементов; false — io_uring недоступен
+    bool init(unsigned entries);
+
+    /// Выполнить пакет: операции отправляются порциями по размеру кольца,
+    /// завершения собираются асинхронно в любом порядке. false — сбой io_uring_enter:
+    /// выполнены только операции с done, остальные надо выполнить синхронно.
+    /// После сбоя кольцо больше не используется (см. threadLocal)
+    bool run(std::vector<Op> &ops);
+
+    /// Проверка один раз на процесс: ядро поддерживает io_uring, STATX и UNLINKAT
+    /// и их не запрещает seccomp/sysctl
+    static bool available();
+
+    /// Кольцо текущего потока (nullptr, если создать не удалось или оно сломалось)
+    static IoUring *threadLocal();
+
+private:
+    int fd = -1;
+    bool broken = false;                // Был сбой io_uring_enter: кольцо закрывается
+    unsigned ringEntries = 0;
+    void *sqRing = nullptr;
+    size_t sqRingSize = 0;
+    void *cqRing = nullptr;
+    size_t cqRingSize = 0;
+    void *sqesMem = nullptr;
+    size_t sqesSize = 0;
+
+    unsigned *sqHead = nullptr;
+    unsigned *sqTail = nullptr;
+    unsigned *sqMask = nullptr;
+    unsigned *sqArray = nullptr;
+    unsigned *cqHead = nullptr;
+    unsigned *cqTail = nullptr;
+    unsigned *cqMask = nullptr;
+    void *cqes = nullptr;
+};
+
+#endif // CLEANER_URING
+
+#endif // URING_H
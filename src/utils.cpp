@@ -5,88 +5,131 @@
 #include <fstream>
 #include <algorithm>
 #include <cctype>
+#include <cstring>
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
 
 namespace fs = std::filesystem;
 
+#ifndef _WIN32
+extern char **environ;
+#endif
+
+static std::string toUpper(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::toupper(c); });
+    return s;
+}
+
+static bool detectWSL() {
+#ifdef _WIN32
+    return false;
+#else
+    const char *env = std::getenv("WSL_DISTRO_NAME");
+    if (env && *env) return true;
+    env = std::getenv("WSL_INTEROP");
+    if (env && *env) return true;
+    std::ifstream in("/proc/version");
+    if (!in) return false;
+    std::string line;
+    std::getline(in, line);
+    return line.find("Microsoft") != std::string::npos || line.find("WSL") != std::string::npos;
+#endif
+}
+
+/// Домашняя папка Windows из WSL: %USERPROFILE%, /mnt/c/Users/$USER
+/// или единственный пользователь в /mnt/c/Users
+static std::string findWindowsHome(const EnvContext &env) {
+    auto var = [&](const char *name) {
+        auto it = env.vars.find(name);
+        return it == env.vars.end() ? std::string() : it->second;
+    };
+    std::string home = var("USERPROFILE");
+    if (!home.empty()) return home;
+
+    std::error_code ec;
+    fs::path base("/mnt/c/Users");
+    if (!fs::is_directory(base, ec)) return std::string();
+    std::string user = var("USER");
+    if (!user.empty() && fs::exists(base / user, ec)) return (base / user).string();
+    std::vector<std::string> candidates;
+    for (auto it = fs::directory_iterator(base, ec); !ec && it != fs::directory_iterator(); it.increment(ec)) {
+        if (!it->is_directory(ec)) continue;
+        std::string name = it->path().filename().string();
+        if (name == "Public" || name == "Default" || name == "Default User" || name == "All Users") continue;
+        candidates.push_back(it->path().string());
+    }
+    return candidates.size() == 1 ? candidates.front() : std::string();
+}
+
+EnvContext captureEnvironment() {
+    EnvContext env;
+#ifdef _WIN32
+    char **entries = _environ;
+#else
+    char **entries = environ;
+#endif
+    for (char **entry = entries; entry && *entry; ++entry) {
+        const char *eq = std::strchr(*entry, '=');
+        if (!eq || eq == *entry) continue;
+        std::string name(*entry, static_cast<size_t>(eq - *entry));
+#ifdef _WIN32
+        name = toUpper(name);   // Имена переменных Windows не различают регистр
+#endif
+        env.vars.emplace(std::move(name), std::string(eq + 1));
+    }
+    auto home = env.vars.find("HOME");
+    env.hasHome = home != env.vars.end();
+    if (env.hasHome) env.home = home->second;
+
+    env.wsl = detectWSL();
+    if (env.wsl) {
+        env.windowsHome = findWindowsHome(env);
+        if (!env.windowsHome.empty()) {
+            // В WSL эти переменные указывают в Linux-окружение, берём пути Windows
+            env.windowsVars["USERPROFILE"] = env.windowsHome;
+            env.windowsVars["LOCALAPPDATA"] = env.windowsHome + "/AppData/Local";
+            env.windowsVars["APPDATA"] = env.windowsHome + "/AppData/Roaming";
+            env.windowsVars["TEMP"] = env.windowsHome + "/AppData/Local/Temp";
+            env.windowsVars["TMP"] = env.windowsHome + "/AppData/Local/Temp";
+            env.windowsVars["PROGRAMDATA"] = "/mnt/c/ProgramData";
+        }
+    }
+    return env;
+}
+
+const EnvContext &environment() {
+    static const EnvContext env = captureEnvironment();
+    return env;
+}
+
 /// Разворачиваем переменные окружения вида %VAR% и тильду
-std::string expandPath(const std::string &path) {
+std::string expandPath(const std::string &path, const EnvContext &env) {
     std::string result;
+    result.reserve(path.size());
     for (size_t i = 0; i < path.size(); ) {
-        if (path[i] == '%' && path.find('%', i + 1) != std::string::npos) {
-            size_t end = path.find('%', i + 1);
+        size_t end = path[i] == '%' ? path.find('%', i + 1) : std::string::npos;
+        if (end != std::string::npos) {
             std::string var = path.substr(i + 1, end - i - 1);
-            const char *val = std::getenv(var.c_str());
-            std::string upperVar = var;
-            std::transform(upperVar.begin(), upperVar.end(), upperVar.begin(),
-                           [](unsigned char c) { return std::toupper(c); });
-            bool wsl = isWSL();
-            bool preferWindows = wsl && (upperVar == "USERPROFILE" ||
-                                         upperVar == "LOCALAPPDATA" ||
-                                         upperVar == "APPDATA" ||
-                                         upperVar == "TEMP" ||
-                                         upperVar == "TMP" ||
-                                         upperVar == "PROGRAMDATA");
-            if (val && !preferWindows) {
-                result += val;
-            } else if (wsl) {
-                std::string winHome;
-                const char *envHome = std::getenv("USERPROFILE");
-                if (envHome && *envHome) {
-                    winHome = envHome;
-                } else {
-                    fs::path base("/mnt/c/Users");
-                    if (fs::exists(base) && fs::is_directory(base)) {
-                        const char *user = std::getenv("USER");
-                        if (user && *user) {
-                            fs::path candidate = base / user;
-                            if (fs::exists(candidate))
-                                winHome = candidate.string();
-                        }
-                        if (winHome.empty()) {
-                            std::vector<std::string> candidates;
-                            for (const auto &entry : fs::directory_iterator(base)) {
-                                if (!entry.is_directory()) continue;
-                                std::string name = entry.path().filename().string();
-                                if (name == "Public" || name == "Default" ||
-                                    name == "Default User" || name == "All Users")
-                                    continue;
-                                candidates.push_back(entry.path().string());
-                            }
-                            if (candidates.size() == 1)
-                                winHome = candidates.front();
-                        }
-                    }
-                }
-                if (!winHome.empty()) {
-                    if (upperVar == "USERPROFILE") {
-                        result += winHome;
-                    } else if (upperVar == "LOCALAPPDATA") {
-                        result += winHome + "/AppData/Local";
-                    } else if (upperVar == "APPDATA") {
-                        result += winHome + "/AppData/Roaming";
-                    } else if (upperVar == "TEMP" || upperVar == "TMP") {
-                        result += winHome + "/AppData/Local/Temp";
-                    } else if (upperVar == "PROGRAMDATA") {
-                        result += "/mnt/c/ProgramData";
-                    } else if (val) {
-                        result += val;
-                    } else {
-                        result += "%" + var + "%";
-                    }
-                } else {
-                    if (val) result += val;
-                    else result += "%" + var + "%";
-                }
+            std::string upperVar = toUpper(var);
+            auto windows = env.windowsVars.find(upperVar);
+#ifdef _WIN32
+            auto value = env.vars.find(upperVar);
+#else
+            auto value = env.vars.find(var);
+#endif
+            if (windows != env.windowsVars.end()) {
+                result += windows->second;
+            } else if (value != env.vars.end()) {
+                result += value->second;
             } else {
-                if (val) result += val;
-                else result += "%" + var + "%";
+                result += "%" + var + "%";
             }
             i = end + 1;
             continue;
         }
         if (path[i] == '~' && (i == 0 || path[i-1] == '/')) {
-            const char *home = std::getenv("HOME");
-            if (home) result += home;
+            if (env.hasHome) result += env.home;
             ++i;
             continue;
         }
@@ -95,10 +138,23 @@ std::string expandPath(const std::string &path) {
     return result;
 }
 
+std::string expandPath(const std::string &path) {
+    return expandPath(path, environment());
+}
+
+std::string serviceDirectory(const EnvContext &env) {
+    auto xdg = env.vars.find("XDG_CACHE_HOME");
+    std::string base = xdg != env.vars.end() && !xdg->second.empty() ? xdg->second : expandPath("~/.cache", env);
+    return (fs::path(base) / "kleyner").lexically_normal().string();
+}
+
+std::string serviceDirectory() {
+    return serviceDirectory(environment());
+}
+
 bool pathExists(const std::string &path) {
     std::error_code ec;
-    std::string p = expandPath(path);
-    bool exists = fs::exists(p, ec);
+    bool exists = fs::exists(path, ec);
     if (ec == std::make_error_code(std::errc::permission_denied)) return true;
     return exists;
 }
@@ -114,41 +170,29 @@ std::vector<fs::path> listFiles(const std::string &directory) {
     return files;
 }
 
-std::uintmax_t directorySize(const fs::path &path) {
-    std::error_code ec;
-    if (!fs::exists(path, ec)) return 0;
-    if (fs::is_regular_file(path, ec)) return fs::file_size(path, ec);
-    std::uintmax_t size = 0;
-    fs::recursive_directory_iterator it(path, fs::directory_options::skip_permission_denied, ec);
-    fs::recursive_directory_iterator end;
-    if (ec) return 0;
-    for (; it != end; it.increment(ec)) {
-        if (ec) {
-            ec.clear();
-            continue;
-        }
-        if (it->is_regular_file(ec)) {
-            if (!ec) size += it->file_size(ec);
-            ec.clear();
-        } else {
-            ec.clear();
-        }
-    }
-    return size;
+bool isWSL() {
+    return environment().wsl;
 }
 
-bool isWSL() {
-#ifdef _WIN32
-    return false;
-#else
-    const char *env = std::getenv("WSL_DISTRO_NAME");
-    if (env && *env) return true;
-    env = std::getenv("WSL_INTEROP");
-    if (env && *env) return true;
-    std::ifstream in("/proc/version");
-    if (!in) return false;
-    std::string line;
-    std::getline(in, line);
-    return line.find("Microsoft") != std::string::npos || line.find("WSL") != std::string::npos;
-#endif
+std::string concat(std::initializer_list<std::string_view> parts) {
+    size_t size = 0;
+    for (std::string_view part : parts) size += part.size();
+    std::string out;
+    out.reserve(size);
+    for (std::string_view part : parts) out.append(part);
+    return out;
+}
+
+std::string formatSize(uintmax_t bytes) {
+    const double mb = 1024.0 * 1024.0;
+    const double gb = mb * 1024.0;
+    std::ostringstream out;
+    out.setf(std::ios::fixed);
+    out << std::setprecision(2);
+    if (bytes >= static_cast<uintmax_t>(gb)) {
+        out << (bytes / gb) << " GB";
+    } else {
+        out << (bytes / mb) << " MB";
+    }
+    return out.str();
 }
@@ -1,22 +1,53 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <cstdint>
+#include <initializer_list>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 #include <filesystem>
 
-/// Разворачивание переменных окружения и тильды в пути
+/// Окружение для разворачивания путей: переменные, WSL и домашняя папка Windows.
+/// Собирается один раз, после чего expandPath — чистая работа со строками.
+struct EnvContext {
+    bool wsl = false;
+    bool hasHome = false;
+    std::string home;                                       // $HOME для тильды
+    std::string windowsHome;                                // В WSL: /mnt/c/Users/<user>
+    std::unordered_map<std::string, std::string> vars;      // Переменные окружения процесса
+    std::unordered_map<std::string, std::string> windowsVars; // В WSL: %USERPROFILE%, %TEMP%... (ключ в верхнем регистре)
+};
+
+/// Снимок окружения: getenv, /proc/version и поиск домашней папки в /mnt/c/Users
+EnvContext captureEnvironment();
+
+/// Окружение процесса, снятое при первом обращении
+const EnvContext &environment();
+
+/// Разворачивание переменных окружения и тильды в пути (без обращений к ФС)
+std::string expandPath(const std::string &path, const EnvContext &env);
 std::string expandPath(const std::string &path);
 
-/// Проверка существования файла или директории
+/// Служебная директория kleyner (кэш сканирования, корзина, статус):
+/// $XDG_CACHE_HOME/kleyner или ~/.cache/kleyner
+std::string serviceDirectory(const EnvContext &env);
+std::string serviceDirectory();
+
+/// Проверка существования уже развёрнутого пути (отказ в доступе — существует)
 bool pathExists(const std::string &path);
 
 /// Получение списка файлов в заданной директории
 std::vector<std::filesystem::path> listFiles(const std::string &directory);
 
-/// Подсчёт размера директории (в байтах)
-std::uintmax_t directorySize(const std::filesystem::path &path);
-
+/// Запуск внутри WSL (по снимку окружения)
 bool isWSL();
 
+/// Размер для журнала: MB или GB с двумя знаками
+std::string formatSize(std::uintmax_t bytes);
+
+/// Склейка строк одним выделением памяти (сообщения журнала из частей string_view)
+std::string concat(std::initializer_list<std::string_view> parts);
+
 #endif // UTILS_H